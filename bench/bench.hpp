@@ -0,0 +1,181 @@
+#pragma once
+
+#include "../counters.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <ostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+#include <x86intrin.h>
+
+/**
+ * TSC ticks to wall time, calibrated against steady_clock once.
+ */
+class tsc_clock {
+  double _ticks_per_ns;
+
+  static double calibrate() {
+    using namespace std::chrono;
+    const auto t0 = steady_clock::now();
+    const uint64_t c0 = __rdtsc();
+    std::this_thread::sleep_for(milliseconds(100));
+    const auto t1 = steady_clock::now();
+    const uint64_t c1 = __rdtsc();
+    return static_cast<double>(c1 - c0) / duration_cast<nanoseconds>(t1 - t0).count();
+  }
+
+public:
+  tsc_clock() : _ticks_per_ns(calibrate()) {}
+
+  static uint64_t now() noexcept {
+    return __rdtsc();
+  }
+
+  double ticks_per_ns() const noexcept {
+    return _ticks_per_ns;
+  }
+
+  double to_ns(const uint64_t ticks) const noexcept {
+    return ticks / _ticks_per_ns;
+  }
+
+  static const tsc_clock& instance() {
+    static const tsc_clock clock;
+    return clock;
+  }
+};
+
+/**
+ * Pins the calling thread to the index-th cpu it is allowed to run on,
+ * wrapping around. Returns the cpu or -1 on failure.
+ */
+inline int pin_thread(const unsigned index) {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if(sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    return -1;
+  const int count = CPU_COUNT(&allowed);
+  if(count == 0)
+    return -1;
+  int target = index % count;
+  for(int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if(CPU_ISSET(cpu, &allowed) && target-- == 0) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(cpu, &set);
+      return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0 ? cpu : -1;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Zipfian ranks in [0, n) (Gray et al., as used by YCSB), theta in (0, 1).
+ * Rank 0 is the most popular.
+ */
+class zipf_distribution {
+  uint64_t _n;
+  double _theta;
+  double _alpha;
+  double _zetan;
+  double _eta;
+  double _half_pow_theta;
+
+  static double zeta(const uint64_t n, const double theta) {
+    double sum = 0;
+    for(uint64_t i = 1; i <= n; i++)
+      sum += 1.0 / std::pow(static_cast<double>(i), theta);
+    return sum;
+  }
+
+public:
+  zipf_distribution(const uint64_t n, const double theta)
+    : _n(n), _theta(theta), _alpha(1.0 / (1.0 - theta)), _zetan(zeta(n, theta)),
+      _eta((1.0 - std::pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta(2, theta) / _zetan)),
+      _half_pow_theta(1.0 + std::pow(0.5, theta)) {}
+
+  template<typename Generator>
+  uint64_t operator()(Generator& gen) const {
+    const double u = std::generate_canonical<double, 53>(gen);
+    const double uz = u * _zetan;
+    if(uz < 1.0)
+      return 0;
+    if(uz < _half_pow_theta)
+      return 1;
+    const uint64_t r = static_cast<uint64_t>(_n * std::pow(_eta * u - _eta + 1.0, _alpha));
+    return r < _n ? r : _n - 1;
+  }
+};
+
+/**
+ * Spreads ranks over the key space so hot keys are not also adjacent.
+ */
+inline uint64_t scramble(uint64_t x) noexcept {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdul;
+  x ^= x >> 33;
+  return x;
+}
+
+/**
+ * One row of output.
+ */
+struct bench_result {
+  std::string structure;
+  std::string distribution;
+  std::string mix;
+  unsigned threads;
+  uint64_t ops;
+  double   seconds;
+  double   mean_ns;
+  double   p50_ns;
+  double   p99_ns;
+  double   p999_ns;
+
+  double mops() const noexcept {
+    return seconds > 0 ? ops / seconds / 1e6 : 0;
+  }
+};
+
+/**
+ * Latency histogram in TSC ticks, converted to ns when reported.
+ */
+template<typename Hist>
+inline void fill_latencies(bench_result& r, const Hist& hist) {
+  const tsc_clock& clock = tsc_clock::instance();
+  r.mean_ns = clock.to_ns(hist.mean());
+  r.p50_ns  = clock.to_ns(hist.percentile(50));
+  r.p99_ns  = clock.to_ns(hist.percentile(99));
+  r.p999_ns = clock.to_ns(hist.percentile(99.9));
+}
+
+inline void print_csv_header(std::ostream& os) {
+  os << "structure,threads,distribution,mix,ops,seconds,mops,mean_ns,p50_ns,p99_ns,p999_ns\n";
+}
+
+inline void print_csv(std::ostream& os, const bench_result& r) {
+  os << r.structure << ',' << r.threads << ',' << r.distribution << ',' << r.mix << ','
+     << r.ops << ',' << r.seconds << ',' << r.mops() << ',' << r.mean_ns << ','
+     << r.p50_ns << ',' << r.p99_ns << ',' << r.p999_ns << '\n';
+}
+
+inline void print_json(std::ostream& os, const std::vector<bench_result>& results) {
+  os << "[\n";
+  for(size_t i = 0; i < results.size(); i++) {
+    const bench_result& r = results[i];
+    os << "  {\"structure\": \"" << r.structure << "\", \"threads\": " << r.threads
+       << ", \"distribution\": \"" << r.distribution << "\", \"mix\": \"" << r.mix
+       << "\", \"ops\": " << r.ops << ", \"seconds\": " << r.seconds
+       << ", \"mops\": " << r.mops() << ", \"mean_ns\": " << r.mean_ns
+       << ", \"p50_ns\": " << r.p50_ns << ", \"p99_ns\": " << r.p99_ns
+       << ", \"p999_ns\": " << r.p999_ns << '}' << (i + 1 < results.size() ? "," : "") << '\n';
+  }
+  os << "]\n";
+}
@@ -0,0 +1,701 @@
+#include "bench.hpp"
+
+#include "../bloom_filter.hpp"
+#include "../clock_cache.hpp"
+#include "../hash_set.hpp"
+#include "../mcs_lock.hpp"
+#include "../mpsc_queue.hpp"
+#include "../rcu_ptr.hpp"
+#include "../rw_lock.hpp"
+#include "../skip_list.hpp"
+#include "../spin_lock.hpp"
+#include "../spsc_queue.hpp"
+#include "../timer_wheel.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <shared_mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono;
+
+using histogram = log_histogram<1>;
+
+static volatile long sink;
+
+struct config {
+  std::vector<std::string> structures;
+  std::vector<unsigned> threads{1, 2, 4};
+  uint64_t ops = 1000000; // per thread
+  unsigned find = 80;
+  unsigned insert = 10;
+  unsigned erase = 10;
+  uint64_t keys = 1 << 20;
+  double fill = 0.5; // keys drawn into a set before timing, as a fraction of keys
+  std::string dist = "uniform";
+  double theta = 0.99;
+  std::string format = "csv";
+  bool pin = true;
+
+  std::string mix() const {
+    std::ostringstream os;
+    os << find << ':' << insert << ':' << erase;
+    return os.str();
+  }
+
+  std::string distribution() const {
+    if(dist == "zipf") {
+      std::ostringstream os;
+      os << "zipf(" << theta << ')';
+      return os.str();
+    }
+    return dist;
+  }
+};
+
+/**
+ * Draws keys uniformly or zipf distributed from [0, keys), scrambled.
+ */
+class key_source {
+  std::mt19937_64 _gen;
+  std::uniform_int_distribution<uint64_t> _uniform;
+  std::shared_ptr<const zipf_distribution> _zipf;
+  uint64_t _keys;
+
+public:
+  key_source(const config& cfg, std::shared_ptr<const zipf_distribution> zipf, const uint64_t seed)
+    : _gen(seed), _uniform(0, cfg.keys - 1), _zipf(std::move(zipf)), _keys(cfg.keys) {}
+
+  long next() {
+    const uint64_t rank = _zipf ? (*_zipf)(_gen) : _uniform(_gen);
+    return static_cast<long>(scramble(rank) & 0x7FFFFFFFFFFFul);
+  }
+
+  unsigned percent() {
+    return _gen() % 100;
+  }
+};
+
+/**
+ * Runs body(index, hist) on n threads released together and returns the
+ * wall time between the release and the last thread finishing.
+ */
+template<typename Body>
+double run_threads(const config& cfg, const unsigned n, histogram& total, Body body) {
+  std::atomic<unsigned> ready(0);
+  std::atomic<bool> go(false);
+  std::vector<std::unique_ptr<histogram>> hists;
+  std::vector<std::thread> threads;
+  for(unsigned i = 0; i < n; i++) {
+    hists.emplace_back(new histogram);
+    threads.emplace_back([&, i] {
+      if(cfg.pin)
+        pin_thread(i);
+      ready++;
+      while(!go.load(std::memory_order_acquire))
+        asm("pause");
+      body(i, *hists[i]);
+    });
+  }
+  while(ready.load() != n)
+    std::this_thread::yield();
+  const auto start = steady_clock::now();
+  go.store(true, std::memory_order_release);
+  for(auto& t : threads)
+    t.join();
+  const double seconds = duration_cast<nanoseconds>(steady_clock::now() - start).count() / 1e9;
+  for(auto& h : hists)
+    total.merge(*h);
+  return seconds;
+}
+
+bench_result make_result(const config& cfg, const std::string& name, const unsigned n,
+                         const uint64_t ops, const double seconds, const histogram& hist) {
+  bench_result r;
+  r.structure = name;
+  r.distribution = cfg.distribution();
+  r.mix = cfg.mix();
+  r.threads = n;
+  r.ops = ops;
+  r.seconds = seconds;
+  fill_latencies(r, hist);
+  return r;
+}
+
+/**
+ * find/insert/erase mix against a set exposing the hash_set interface.
+ */
+template<typename Set>
+bench_result bench_set(const config& cfg, const std::string& name, const unsigned n,
+                       std::shared_ptr<const zipf_distribution> zipf, Set& set) {
+  std::vector<uint64_t> tids;
+  for(unsigned i = 0; i < n; i++)
+    tids.push_back(set.qs.register_thread());
+
+  // On a worker's tid, a tid that never passes through a quiescent state
+  // again would stall reclamation for the whole run.
+  key_source prefill(cfg, nullptr, 42);
+  for(uint64_t i = 0; i < cfg.keys * cfg.fill; i++)
+    set.insert(prefill.next(), tids[0]);
+
+  histogram hist;
+  const double seconds = run_threads(cfg, n, hist, [&](const unsigned index, histogram& h) {
+    key_source keys(cfg, zipf, index + 1);
+    const uint64_t tid = tids[index];
+    long found = 0; // keeps find() from being optimised away
+    for(uint64_t i = 0; i < cfg.ops; i++) {
+      const unsigned p = keys.percent();
+      const long key = keys.next();
+      const uint64_t start = tsc_clock::now();
+      if(p < cfg.find)
+        found += set.find(key, tid, false);
+      else if(p < cfg.find + cfg.insert)
+        set.insert(key, tid);
+      else
+        set.erase(key, tid);
+      h.record(tsc_clock::now() - start);
+    }
+    sink = found;
+  });
+  return make_result(cfg, name, n, n * cfg.ops, seconds, hist);
+}
+
+/**
+ * A bloom_filter sized for and holding keys * fill keys on its own, the
+ * find share of the mix calls contains() and the rest insert(). A lookup
+ * is too short to time on its own, keys are drawn in batches of 16 and
+ * the latency recorded is that of the batch divided by 16.
+ */
+bench_result bench_bloom(const config& cfg, const std::string& name, const unsigned n,
+                         std::shared_ptr<const zipf_distribution> zipf) {
+  constexpr unsigned BATCH = 16;
+  const uint64_t items = cfg.keys * cfg.fill > 1 ? cfg.keys * cfg.fill : 1;
+  std::unique_ptr<bloom_filter> filter(new bloom_filter(items));
+  const std::hash<long> hash;
+  key_source prefill(cfg, nullptr, 42);
+  for(uint64_t i = 0; i < items; i++)
+    filter->insert(hash(prefill.next()));
+
+  histogram hist;
+  const uint64_t ops = (cfg.ops + BATCH - 1) / BATCH * BATCH;
+  const double seconds = run_threads(cfg, n, hist, [&](const unsigned index, histogram& h) {
+    key_source keys(cfg, zipf, index + 1);
+    long found = 0;
+    for(uint64_t i = 0; i < ops; i += BATCH) {
+      size_t hashes[BATCH];
+      bool finds[BATCH];
+      for(unsigned j = 0; j < BATCH; j++) {
+        finds[j] = keys.percent() < cfg.find;
+        hashes[j] = hash(keys.next());
+      }
+      const uint64_t start = tsc_clock::now();
+      for(unsigned j = 0; j < BATCH; j++) {
+        if(finds[j])
+          found += filter->contains(hashes[j]);
+        else
+          filter->insert(hashes[j]);
+      }
+      h.record((tsc_clock::now() - start) / BATCH);
+    }
+    sink = found;
+  });
+  return make_result(cfg, name, n, n * ops, seconds, hist);
+}
+
+/**
+ * Read-through cache of keys * fill entries: get, and insert on a miss.
+ * The mix is ignored, the hit ratio goes to stderr.
+ */
+bench_result bench_cache(const config& cfg, const std::string& name, const unsigned n,
+                         std::shared_ptr<const zipf_distribution> zipf) {
+  const uint64_t capacity = cfg.keys * cfg.fill > 1 ? cfg.keys * cfg.fill : 1;
+  std::unique_ptr<clock_cache<long, long>> cache(new clock_cache<long, long>(capacity));
+  std::vector<uint64_t> tids;
+  for(unsigned i = 0; i < n; i++)
+    tids.push_back(cache->register_thread());
+
+  histogram hist;
+  const double seconds = run_threads(cfg, n, hist, [&](const unsigned index, histogram& h) {
+    key_source keys(cfg, zipf, index + 1);
+    const uint64_t tid = tids[index];
+    long sum = 0;
+    for(uint64_t i = 0; i < cfg.ops; i++) {
+      const long key = keys.next();
+      const uint64_t start = tsc_clock::now();
+      long value;
+      if(!cache->get(key, value, tid, false))
+        cache->insert(key, value = key, tid);
+      sum += value;
+      h.record(tsc_clock::now() - start);
+    }
+    sink = sum;
+  });
+  const int64_t lookups = cache->hits() + cache->misses();
+  std::cerr << name << ' ' << n << " threads: hit ratio "
+            << static_cast<double>(cache->hits()) / (lookups ? lookups : 1)
+            << ", " << cache->evictions() << " evictions\n";
+  return make_result(cfg, name, n, n * cfg.ops, seconds, hist);
+}
+
+/**
+ * Every operation is a short critical section on a few shared lines.
+ */
+template<typename Lock>
+bench_result bench_lock(const config& cfg, const std::string& name, const unsigned n) {
+  Lock lock;
+  struct alignas(64) line { long value = 0; };
+  line shared[2];
+  histogram hist;
+  const double seconds = run_threads(cfg, n, hist, [&](unsigned, histogram& h) {
+    for(uint64_t i = 0; i < cfg.ops; i++) {
+      const uint64_t start = tsc_clock::now();
+      lock.lock();
+      shared[0].value++;
+      shared[1].value++;
+      lock.unlock();
+      h.record(tsc_clock::now() - start);
+    }
+  });
+  return make_result(cfg, name, n, n * cfg.ops, seconds, hist);
+}
+
+/**
+ * The find share of the mix takes the lock shared, the rest exclusive.
+ */
+bench_result bench_rw_lock(const config& cfg, const std::string& name, const unsigned n) {
+  rw_lock<> lock;
+  struct alignas(64) line { long value = 0; };
+  line shared[2];
+  histogram hist;
+  const double seconds = run_threads(cfg, n, hist, [&](const unsigned index, histogram& h) {
+    key_source keys(cfg, nullptr, index + 1);
+    long sum = 0;
+    for(uint64_t i = 0; i < cfg.ops; i++) {
+      const bool read = keys.percent() < cfg.find;
+      const uint64_t start = tsc_clock::now();
+      if(read) {
+        std::shared_lock<rw_lock<>> guard(lock);
+        sum += shared[0].value + shared[1].value;
+      }
+      else {
+        std::lock_guard<rw_lock<>> guard(lock);
+        shared[0].value++;
+        shared[1].value++;
+      }
+      h.record(tsc_clock::now() - start);
+    }
+    sink = sum;
+  });
+  return make_result(cfg, name, n, n * cfg.ops, seconds, hist);
+}
+
+/**
+ * Retire a small allocation and pass through a quiescent state, except
+ * for the find share of the mix which only passes through.
+ */
+bench_result bench_qsbr(const config& cfg, const std::string& name, const unsigned n) {
+  std::unique_ptr<qsbr> qs(new qsbr);
+  std::vector<uint64_t> tids;
+  for(unsigned i = 0; i < n; i++)
+    tids.push_back(qs->register_thread());
+  histogram hist;
+  const double seconds = run_threads(cfg, n, hist, [&](const unsigned index, histogram& h) {
+    key_source keys(cfg, nullptr, index + 1);
+    for(uint64_t i = 0; i < cfg.ops; i++) {
+      const bool retire = keys.percent() >= cfg.find;
+      const uint64_t start = tsc_clock::now();
+      if(retire)
+        qs->deferred_free(malloc(16));
+      qs->quiescent(tids[index]);
+      h.record(tsc_clock::now() - start);
+    }
+  });
+  return make_result(cfg, name, n, n * cfg.ops, seconds, hist);
+}
+
+/**
+ * One producer, one consumer. Latency is that of push.
+ */
+bench_result bench_spsc(const config& cfg, const std::string& name) {
+  spsc_queue<long> q(1 << 16);
+  histogram hist;
+  const double seconds = run_threads(cfg, 2, hist, [&](const unsigned index, histogram& h) {
+    if(index == 0) {
+      for(uint64_t i = 0; i < cfg.ops; i++) {
+        const uint64_t start = tsc_clock::now();
+        while(!q.push(i));
+        h.record(tsc_clock::now() - start);
+      }
+    }
+    else {
+      long v;
+      for(uint64_t i = 0; i < cfg.ops; i++)
+        while(!q.pop(v));
+    }
+  });
+  return make_result(cfg, name, 2, cfg.ops, seconds, hist);
+}
+
+/**
+ * n producers, one consumer. Latency is that of push.
+ */
+bench_result bench_mpsc(const config& cfg, const std::string& name, const unsigned n) {
+  mpsc_queue<long> q;
+  histogram hist;
+  const double seconds = run_threads(cfg, n + 1, hist, [&](const unsigned index, histogram& h) {
+    if(index < n) {
+      for(uint64_t i = 0; i < cfg.ops; i++) {
+        const uint64_t start = tsc_clock::now();
+        q.push(i);
+        h.record(tsc_clock::now() - start);
+      }
+    }
+    else {
+      long v;
+      for(uint64_t i = 0; i < n * cfg.ops; i++)
+        while(!q.pop(v));
+    }
+  });
+  return make_result(cfg, name, n + 1, n * cfg.ops, seconds, hist);
+}
+
+/**
+ * The mutex and binary heap timer_wheel replaces.
+ */
+class timer_heap {
+  std::mutex _lock;
+  std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t>> _heap;
+  std::atomic<uint64_t> _now{0};
+
+public:
+  uint64_t now() const {
+    return _now.load(std::memory_order_acquire);
+  }
+
+  void post(const uint64_t deadline) {
+    std::lock_guard<std::mutex> guard(_lock);
+    _heap.push(deadline);
+  }
+
+  size_t tick(const uint64_t now) {
+    size_t fired = 0;
+    std::lock_guard<std::mutex> guard(_lock);
+    while(!_heap.empty() && _heap.top() <= now) {
+      _heap.pop();
+      fired++;
+    }
+    _now.store(now + 1, std::memory_order_release);
+    return fired;
+  }
+};
+
+class timer_wheel_adapter {
+  timer_wheel<long> _wheel;
+
+public:
+  uint64_t now() const {
+    return _wheel.now();
+  }
+
+  void post(const uint64_t deadline) {
+    _wheel.post(deadline, 0);
+  }
+
+  size_t tick(const uint64_t now) {
+    return _wheel.tick(now, [](long) {});
+  }
+};
+
+/**
+ * n threads arm timers due up to --keys ticks ahead, one thread ticks
+ * until all of them fired. Latency is that of arming a timer.
+ */
+template<typename Timers>
+bench_result bench_timers(const config& cfg, const std::string& name, const unsigned n) {
+  std::unique_ptr<Timers> timers(new Timers);
+  std::atomic<uint64_t> fired(0);
+  histogram hist;
+  const double seconds = run_threads(cfg, n + 1, hist, [&](const unsigned index, histogram& h) {
+    if(index < n) {
+      key_source keys(cfg, nullptr, index + 1);
+      for(uint64_t i = 0; i < cfg.ops; i++) {
+        const uint64_t deadline = timers->now() + keys.next() % cfg.keys;
+        const uint64_t start = tsc_clock::now();
+        timers->post(deadline);
+        h.record(tsc_clock::now() - start);
+      }
+    }
+    else {
+      uint64_t total = 0;
+      for(uint64_t now = 0; total < n * cfg.ops; now += 16)
+        total += timers->tick(now);
+      fired = total;
+    }
+  });
+  sink = fired.load();
+  return make_result(cfg, name, n + 1, n * cfg.ops, seconds, hist);
+}
+
+struct routing_table {
+  long _routes[8];
+};
+
+/**
+ * n threads read a shared object through rcu_ptr, passing through a
+ * quiescent state every 256 reads, while one more thread keeps
+ * replacing it. Latency is that of a read.
+ */
+bench_result bench_rcu_ptr(const config& cfg, const std::string& name, const unsigned n) {
+  std::unique_ptr<qsbr> qs(new qsbr);
+  std::vector<uint64_t> tids;
+  for(unsigned i = 0; i <= n; i++)
+    tids.push_back(qs->register_thread());
+  rcu_ptr<routing_table> table(*qs, routing_table{});
+  std::atomic<unsigned> readers(n);
+  histogram hist;
+  const double seconds = run_threads(cfg, n + 1, hist, [&](const unsigned index, histogram& h) {
+    if(index < n) {
+      long sum = 0;
+      for(uint64_t i = 0; i < cfg.ops; i++) {
+        const uint64_t start = tsc_clock::now();
+        sum += table->_routes[i & 7];
+        h.record(tsc_clock::now() - start);
+        if(i % 256 == 255)
+          qs->quiescent(tids[index]);
+      }
+      sink = sum;
+      qs->quiescent(tids[index]);
+      readers--;
+    }
+    else {
+      for(long v = 0; readers.load(std::memory_order_relaxed); v++) {
+        table.store(routing_table{{v, v, v, v, v, v, v, v}});
+        qs->quiescent(tids[index]);
+      }
+    }
+  });
+  return make_result(cfg, name, n + 1, n * cfg.ops, seconds, hist);
+}
+
+/**
+ * Same as bench_rcu_ptr through std::atomic_load of a std::shared_ptr.
+ */
+bench_result bench_shared_ptr(const config& cfg, const std::string& name, const unsigned n) {
+  std::shared_ptr<const routing_table> table = std::make_shared<routing_table>();
+  std::atomic<unsigned> readers(n);
+  histogram hist;
+  const double seconds = run_threads(cfg, n + 1, hist, [&](const unsigned index, histogram& h) {
+    if(index < n) {
+      long sum = 0;
+      for(uint64_t i = 0; i < cfg.ops; i++) {
+        const uint64_t start = tsc_clock::now();
+        sum += std::atomic_load(&table)->_routes[i & 7];
+        h.record(tsc_clock::now() - start);
+      }
+      sink = sum;
+      readers--;
+    }
+    else {
+      for(long v = 0; readers.load(std::memory_order_relaxed); v++)
+        std::atomic_store(&table, std::shared_ptr<const routing_table>(new routing_table{{v, v, v, v, v, v, v, v}}));
+    }
+  });
+  return make_result(cfg, name, n + 1, n * cfg.ops, seconds, hist);
+}
+
+using runner = std::function<bench_result(const config&, unsigned, std::shared_ptr<const zipf_distribution>)>;
+
+static const std::map<std::string, runner>& structures() {
+  static const std::map<std::string, runner> all = {
+    {"spsc_queue", [](const config& cfg, unsigned, std::shared_ptr<const zipf_distribution>) {
+      return bench_spsc(cfg, "spsc_queue");
+    }},
+    {"mpsc_queue", [](const config& cfg, unsigned n, std::shared_ptr<const zipf_distribution>) {
+      return bench_mpsc(cfg, "mpsc_queue", n);
+    }},
+    {"hash_set", [](const config& cfg, unsigned n, std::shared_ptr<const zipf_distribution> zipf) {
+      std::unique_ptr<hash_set<long>> set(new hash_set<long>(cfg.keys / 4));
+      return bench_set(cfg, "hash_set", n, zipf, *set);
+    }},
+    {"hash_set_bloom", [](const config& cfg, unsigned n, std::shared_ptr<const zipf_distribution> zipf) {
+      using bloom_set = hash_set<long, 8, std::hash<long>, std::equal_to<long>, no_stats, std::allocator<long>, bloom_front>;
+      std::unique_ptr<bloom_set> set(new bloom_set(cfg.keys / 4));
+      return bench_set(cfg, "hash_set_bloom", n, zipf, *set);
+    }},
+    {"bloom_filter", [](const config& cfg, unsigned n, std::shared_ptr<const zipf_distribution> zipf) {
+      return bench_bloom(cfg, "bloom_filter", n, zipf);
+    }},
+    {"skip_list", [](const config& cfg, unsigned n, std::shared_ptr<const zipf_distribution> zipf) {
+      std::unique_ptr<skip_set<long>> set(new skip_set<long>);
+      return bench_set(cfg, "skip_list", n, zipf, *set);
+    }},
+    {"clock_cache", [](const config& cfg, unsigned n, std::shared_ptr<const zipf_distribution> zipf) {
+      return bench_cache(cfg, "clock_cache", n, zipf);
+    }},
+    {"timer_wheel", [](const config& cfg, unsigned n, std::shared_ptr<const zipf_distribution>) {
+      return bench_timers<timer_wheel_adapter>(cfg, "timer_wheel", n);
+    }},
+    {"timer_heap", [](const config& cfg, unsigned n, std::shared_ptr<const zipf_distribution>) {
+      return bench_timers<timer_heap>(cfg, "timer_heap", n);
+    }},
+    {"rcu_ptr", [](const config& cfg, unsigned n, std::shared_ptr<const zipf_distribution>) {
+      return bench_rcu_ptr(cfg, "rcu_ptr", n);
+    }},
+    {"shared_ptr", [](const config& cfg, unsigned n, std::shared_ptr<const zipf_distribution>) {
+      return bench_shared_ptr(cfg, "shared_ptr", n);
+    }},
+    {"qsbr", [](const config& cfg, unsigned n, std::shared_ptr<const zipf_distribution>) {
+      return bench_qsbr(cfg, "qsbr", n);
+    }},
+    {"spin_lock", [](const config& cfg, unsigned n, std::shared_ptr<const zipf_distribution>) {
+      return bench_lock<spin_lock>(cfg, "spin_lock", n);
+    }},
+    {"spin_lock_backoff", [](const config& cfg, unsigned n, std::shared_ptr<const zipf_distribution>) {
+      return bench_lock<spin_lock_backoff>(cfg, "spin_lock_backoff", n);
+    }},
+    {"adaptive_lock", [](const config& cfg, unsigned n, std::shared_ptr<const zipf_distribution>) {
+      return bench_lock<adaptive_lock>(cfg, "adaptive_lock", n);
+    }},
+    {"mcs_lock", [](const config& cfg, unsigned n, std::shared_ptr<const zipf_distribution>) {
+      return bench_lock<easy_mcs_lock<>>(cfg, "mcs_lock", n);
+    }},
+    {"cohort_lock", [](const config& cfg, unsigned n, std::shared_ptr<const zipf_distribution>) {
+      return bench_lock<easy_cohort_lock<>>(cfg, "cohort_lock", n);
+    }},
+    {"rw_lock", [](const config& cfg, unsigned n, std::shared_ptr<const zipf_distribution>) {
+      return bench_rw_lock(cfg, "rw_lock", n);
+    }},
+  };
+  return all;
+}
+
+static std::vector<std::string> split(const std::string& s, const char sep) {
+  std::vector<std::string> parts;
+  std::istringstream is(s);
+  std::string part;
+  while(std::getline(is, part, sep))
+    parts.push_back(part);
+  return parts;
+}
+
+static int usage(const char* argv0) {
+  std::cerr << "usage: " << argv0 << " [options]\n"
+            << "  --structure a,b,...   structures to run (default all):";
+  for(const auto& s : structures())
+    std::cerr << ' ' << s.first;
+  std::cerr << "\n"
+            << "  --threads 1,2,4       thread counts\n"
+            << "  --ops N               operations per thread\n"
+            << "  --mix F:I:E           find:insert:erase percentages\n"
+            << "  --keys N              key space size\n"
+            << "  --fill F              keys drawn into sets up front, and cache capacity,\n"
+            << "                        as a fraction of --keys\n"
+            << "  --dist uniform|zipf   key distribution\n"
+            << "  --theta T             zipf skew in (0, 1)\n"
+            << "  --format csv|json     output format\n"
+            << "  --no-pin              do not pin threads to cpus\n";
+  return 2;
+}
+
+int main(int argc, char** argv) {
+#ifdef LOCKFREE_REQUIRE_AVX2
+  if(!__builtin_cpu_supports("avx2")) {
+    std::cerr << argv[0] << ": cpu lacks avx2" << std::endl;
+    return 1;
+  }
+#endif
+  config cfg;
+  try {
+    for(int i = 1; i < argc; i++) {
+      const std::string arg = argv[i];
+      const bool has_value = i + 1 < argc;
+      if(arg == "--no-pin")
+        cfg.pin = false;
+      else if(!has_value)
+        return usage(argv[0]);
+      else if(arg == "--structure")
+        cfg.structures = split(argv[++i], ',');
+      else if(arg == "--threads") {
+        cfg.threads.clear();
+        for(const auto& t : split(argv[++i], ','))
+          cfg.threads.push_back(std::stoul(t));
+      }
+      else if(arg == "--ops")
+        cfg.ops = std::stoull(argv[++i]);
+      else if(arg == "--mix") {
+        const auto parts = split(argv[++i], ':');
+        if(parts.size() != 3)
+          return usage(argv[0]);
+        cfg.find = std::stoul(parts[0]);
+        cfg.insert = std::stoul(parts[1]);
+        cfg.erase = std::stoul(parts[2]);
+      }
+      else if(arg == "--keys")
+        cfg.keys = std::stoull(argv[++i]);
+      else if(arg == "--fill")
+        cfg.fill = std::stod(argv[++i]);
+      else if(arg == "--dist")
+        cfg.dist = argv[++i];
+      else if(arg == "--theta")
+        cfg.theta = std::stod(argv[++i]);
+      else if(arg == "--format")
+        cfg.format = argv[++i];
+      else
+        return usage(argv[0]);
+    }
+  }
+  catch(const std::invalid_argument&) {
+    return usage(argv[0]);
+  }
+  catch(const std::out_of_range&) {
+    return usage(argv[0]);
+  }
+
+  if(cfg.find + cfg.insert + cfg.erase != 100 || cfg.keys < 2 ||
+     !(cfg.fill >= 0 && cfg.fill <= 1) || !(cfg.theta > 0 && cfg.theta < 1) ||
+     (cfg.dist != "uniform" && cfg.dist != "zipf") ||
+     (cfg.format != "csv" && cfg.format != "json"))
+    return usage(argv[0]);
+  for(const unsigned n : cfg.threads)
+    if(n == 0 || n > 63) // qsbr allows 64 ids, bench_rcu_ptr registers n + 1 and the mpsc runs use n + 1 threads
+      return usage(argv[0]);
+  if(cfg.structures.empty())
+    for(const auto& s : structures())
+      cfg.structures.push_back(s.first);
+  for(const auto& name : cfg.structures)
+    if(!structures().count(name))
+      return usage(argv[0]);
+
+  std::shared_ptr<const zipf_distribution> zipf;
+  if(cfg.dist == "zipf")
+    zipf = std::make_shared<zipf_distribution>(cfg.keys, cfg.theta);
+
+  tsc_clock::instance(); // calibrate up front
+
+  std::vector<bench_result> results;
+  if(cfg.format == "csv")
+    print_csv_header(std::cout);
+  for(const auto& name : cfg.structures) {
+    for(const unsigned n : cfg.threads) {
+      results.push_back(structures().at(name)(cfg, n, zipf));
+      if(cfg.format == "csv")
+        print_csv(std::cout, results.back());
+      if(name == "spsc_queue")
+        break; // always two threads
+    }
+  }
+  if(cfg.format == "json")
+    print_json(std::cout, results);
+  return 0;
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "gc.hpp"
+#include "pages.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+/**
+ * Concurrent blocked bloom filter over precomputed hashes.
+ *
+ * Each key maps to one cache line sized block of eight words and sets
+ * one bit in every word, so a lookup costs a single cache miss. Hashes
+ * are remixed with fmix64 first, std::hash for integers is the identity.
+ * Bits are only ever set, insert() is a relaxed fetch_or per word and
+ * contains() may run concurrently with it. There is no removal, rebuild
+ * a fresh filter instead.
+ */
+class bloom_filter : public collectable {
+
+  struct alignas(64) block {
+    std::atomic<uint64_t> _words[8];
+  };
+
+  alignas(32) static constexpr uint32_t SALTS[8] = {
+    0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+    0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u
+  };
+
+  const size_t _mask;
+  block* const _blocks;
+
+  static size_t block_count(const size_t items, const unsigned bits_per_item) {
+    const size_t bits = items * bits_per_item;
+    size_t n = 1;
+    while(n * 512 < bits)
+      n <<= 1;
+    return n;
+  }
+
+  // Lookups are random, map large filters with huge pages to spare the TLB.
+  static size_t map_bytes(const size_t blocks) noexcept {
+    const size_t bytes = blocks * sizeof(block);
+    return bytes < HUGE_PAGE_SIZE ? bytes : (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+  }
+
+  const block& block_of(const uint64_t h) const noexcept {
+    return _blocks[(h >> 32) & _mask];
+  }
+
+  block& block_of(const uint64_t h) noexcept {
+    return _blocks[(h >> 32) & _mask];
+  }
+
+  static void masks(const uint64_t h, uint64_t (&m)[8]) noexcept {
+    for(unsigned i = 0; i < 8; i++)
+      m[i] = 1ul << ((static_cast<uint32_t>(h) * SALTS[i]) >> 26);
+  }
+
+public:
+
+  static uint64_t fmix64(uint64_t h) noexcept {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdul;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ul;
+    h ^= h >> 33;
+    return h;
+  }
+
+  /**
+   * Sized for items keys at bits_per_item, rounded up to a power of two
+   * blocks. 16 bits per item gives a false positive rate below 0.5%.
+   */
+  bloom_filter(const size_t items, const unsigned bits_per_item = 16)
+    : _mask(block_count(items, bits_per_item) - 1),
+      _blocks(static_cast<block*>(map_pages(map_bytes(_mask + 1), true))) {}
+
+  virtual ~bloom_filter() override {
+    unmap_pages(_blocks, map_bytes(_mask + 1));
+  }
+
+  size_t size_in_bytes() const noexcept {
+    return (_mask + 1) * sizeof(block);
+  }
+
+  void insert(const uint64_t hash) {
+    const uint64_t h = fmix64(hash);
+    block& b = block_of(h);
+    uint64_t m[8];
+    masks(h, m);
+    for(unsigned i = 0; i < 8; i++) {
+      // Skip the write, and the cache line invalidation, if already set.
+      if((b._words[i].load(std::memory_order_relaxed) & m[i]) != m[i])
+        b._words[i].fetch_or(m[i], std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * False means hash was never inserted, true that it probably was.
+   */
+  bool contains(const uint64_t hash) const {
+    const uint64_t h = fmix64(hash);
+    const block& b = block_of(h);
+#ifdef __AVX2__
+    // Plain vector loads of the atomic words. Bits only go from 0 to 1,
+    // so a racing insert can at worst make this miss the newest bits.
+    const __m256i salts = _mm256_load_si256(reinterpret_cast<const __m256i*>(SALTS));
+    const __m256i product = _mm256_mullo_epi32(_mm256_set1_epi32(static_cast<uint32_t>(h)), salts);
+    const __m256i shifts = _mm256_srli_epi32(product, 26);
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m256i lo = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(shifts)));
+    const __m256i hi = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(shifts, 1)));
+    const __m256i* const words = reinterpret_cast<const __m256i*>(b._words);
+    return _mm256_testc_si256(_mm256_load_si256(words), lo) &
+           _mm256_testc_si256(_mm256_load_si256(words + 1), hi);
+#else
+    uint64_t m[8];
+    masks(h, m);
+    uint64_t missing = 0;
+    for(unsigned i = 0; i < 8; i++)
+      missing |= ~b._words[i].load(std::memory_order_relaxed) & m[i];
+    return missing == 0;
+#endif
+  }
+
+  // Not thread safe.
+  void clear() {
+    for(size_t i = 0; i <= _mask; i++)
+      for(auto& w : _blocks[i]._words)
+        w.store(0, std::memory_order_relaxed);
+  }
+};
+
+/**
+ * hash_set Filter policy keeping a bloom_filter in front of the table so
+ * find() can return early for keys that are definitely absent.
+ *
+ * Erased keys stay in the filter until the next rehash, which builds a
+ * fresh filter from the new table and retires the old one through qsbr.
+ * The filter is sized per table slot, and as tables rarely run more than
+ * half full the default 8 bits per slot is about 16 per key.
+ */
+class bloom_front {
+
+  std::atomic<bloom_filter*> _filter;
+  bloom_filter*              _next = nullptr; // only touched by the rehashing thread
+  const unsigned             _bits_per_item;
+
+public:
+
+  explicit bloom_front(const size_t capacity, const unsigned bits_per_item = 8)
+    : _filter(new bloom_filter(capacity, bits_per_item)), _bits_per_item(bits_per_item) {}
+
+  ~bloom_front() {
+    delete _filter.load();
+  }
+
+  bool may_contain(const size_t hash) const {
+    return _filter.load(std::memory_order_acquire)->contains(hash);
+  }
+
+  void add(const size_t hash) {
+    _filter.load(std::memory_order_acquire)->insert(hash);
+  }
+
+  void rebuild_begin(const size_t capacity) {
+    _next = new bloom_filter(capacity, _bits_per_item);
+  }
+
+  void rebuild_add(const size_t hash) {
+    _next->insert(hash);
+  }
+
+  void rebuild_end(qsbr& qs) {
+    qs.deferred_delete(_filter.exchange(_next, std::memory_order_acq_rel));
+    _next = nullptr;
+  }
+};
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+
+/**
+ * Disruptor style single producer, multi consumer broadcast ring.
+ *
+ * Every consumer sees every element, each at its own pace, tracked by
+ * its own padded sequence. A consumer can be made to depend on others,
+ * in which case it only reads elements they have all released. The
+ * producer never overwrites an element some consumer has not released.
+ *
+ * Consumers must be added before the producer starts publishing.
+ * Misuse, such as too many consumers or a size that is not a power of
+ * two, fails an assert.
+ */
+template<typename T, size_t MaxConsumers = 16>
+class broadcast_ring {
+
+  static_assert(MaxConsumers <= 64, "dependencies are a 64 bit mask");
+
+  struct alignas(64) sequence {
+    std::atomic<uint64_t> _value{0};
+  };
+
+  // Written by the producer only.
+  sequence _cursor;
+  struct alignas(64) {
+    uint64_t _claimed = 0;
+    uint64_t _gate = 0; // cached minimum of all consumers
+  } _producer;
+
+  const uint64_t _len;
+  const uint64_t _mask;
+  const std::unique_ptr<T[]> _data;
+  unsigned _nconsumers;
+  uint64_t _dependencies[MaxConsumers]; // bitmask of consumers to wait for
+  sequence _consumers[MaxConsumers];
+
+  uint64_t slowest_consumer() const {
+    uint64_t min = _producer._claimed;
+    for(unsigned i = 0; i < _nconsumers; i++) {
+      const uint64_t s = _consumers[i]._value.load(std::memory_order_acquire);
+      if(s < min)
+        min = s;
+    }
+    return min;
+  }
+
+public:
+
+  broadcast_ring(const uint64_t size)
+    : _len(size), _mask(size - 1), _data(new T[size]), _nconsumers(0) {
+    assert(size != 0 && (size & (size - 1)) == 0);
+  }
+
+  uint64_t capacity() const {
+    return _len;
+  }
+
+  /**
+   * Registers a consumer which only reads elements already released by
+   * every consumer in after, all of them added earlier. Returns the
+   * consumer id. At most MaxConsumers consumers.
+   */
+  unsigned add_consumer(std::initializer_list<unsigned> after = {}) {
+    const unsigned id = _nconsumers;
+    assert(id < MaxConsumers);
+    uint64_t mask = 0;
+    for(const unsigned dep : after) {
+      assert(dep < id);
+      mask |= 1ul << dep;
+    }
+    _dependencies[id] = mask;
+    _consumers[id]._value.store(_cursor._value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    _nconsumers++;
+    return id;
+  }
+
+  // Producer
+
+  bool try_claim(const uint64_t n, uint64_t& first) {
+    assert(n <= _len);
+    const uint64_t end = _producer._claimed + n;
+    if(end > _producer._gate + _len) {
+      _producer._gate = slowest_consumer();
+      if(end > _producer._gate + _len)
+        return false;
+    }
+    first = _producer._claimed;
+    _producer._claimed = end;
+    return true;
+  }
+
+  /**
+   * Claims n (at most capacity()) consecutive slots, waiting for the
+   * slowest consumer if the ring is full. Returns the first sequence.
+   */
+  uint64_t claim(const uint64_t n = 1) {
+    uint64_t first;
+    while(!try_claim(n, first))
+      asm("pause");
+    return first;
+  }
+
+  T& operator[](const uint64_t seq) {
+    return _data[seq & _mask];
+  }
+
+  /**
+   * Makes every claimed slot before end visible to consumers.
+   */
+  void publish(const uint64_t end) {
+    _cursor._value.store(end, std::memory_order_release);
+  }
+
+  void push(const T& value) {
+    const uint64_t seq = claim(1);
+    _data[seq & _mask] = value;
+    publish(seq + 1);
+  }
+
+  // Consumers
+
+  uint64_t position(const unsigned id) const {
+    return _consumers[id]._value.load(std::memory_order_acquire);
+  }
+
+  /**
+   * End (exclusive) of the range consumer id may currently read.
+   */
+  uint64_t available(const unsigned id) const {
+    uint64_t end = _cursor._value.load(std::memory_order_acquire);
+    for(uint64_t deps = _dependencies[id]; deps; deps &= deps - 1) {
+      const uint64_t s = _consumers[__builtin_ctzl(deps)]._value.load(std::memory_order_acquire);
+      if(s < end)
+        end = s;
+    }
+    return end;
+  }
+
+  const T& at(const uint64_t seq) const {
+    return _data[seq & _mask];
+  }
+
+  /**
+   * Releases every element before end back to the producer and to the
+   * consumers depending on id.
+   */
+  void release(const unsigned id, const uint64_t end) {
+    _consumers[id]._value.store(end, std::memory_order_release);
+  }
+
+  /**
+   * Calls fn on up to max available elements, then releases them in one
+   * go. Returns the number of elements consumed.
+   */
+  template<typename Func>
+  size_t poll(const unsigned id, Func&& fn, const uint64_t max = std::numeric_limits<uint64_t>::max()) {
+    const uint64_t begin = _consumers[id]._value.load(std::memory_order_relaxed);
+    uint64_t end = available(id);
+    if(end - begin > max)
+      end = begin + max;
+    for(uint64_t s = begin; s < end; s++)
+      fn(_data[s & _mask]);
+    if(end != begin)
+      release(id, end);
+    return end - begin;
+  }
+};
@@ -0,0 +1,189 @@
+#pragma once
+
+#include "counters.hpp"
+#include "hash_set.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+/**
+ * Concurrent bounded cache with CLOCK eviction.
+ *
+ * Key to entry mappings live in a hash_set, the entries themselves in a
+ * ring of capacity slots swept by a shared clock hand. A hit only sets
+ * the entry's referenced bit with a relaxed store, there is no list to
+ * reorder and no lock. insert() moves the hand, clearing referenced bits
+ * until it finds an unreferenced entry to replace.
+ *
+ * Entries are immutable and reclaimed through the hash_set's qsbr: threads
+ * register with register_thread() and must pass through quiescent
+ * states like for any hash_set.
+ */
+template<typename Key,
+         typename Value,
+         typename Hash = std::hash<Key>,
+         typename Equal = std::equal_to<Key>>
+class clock_cache {
+
+  struct entry : public collectable {
+    const Key         _key;
+    const Value       _value;
+    std::atomic<bool> _referenced;
+    std::atomic<bool> _dead; // the thread setting this removes the mapping
+
+    entry(const Key& k, const Value& v) : collectable(), _key(k), _value(v), _referenced(false), _dead(false) {}
+  };
+
+  // What the index stores, looked up by key without copying it.
+  struct ref {
+    const Key* _key;
+    entry*     _entry;
+  };
+
+  struct ref_hash : private Hash {
+    size_t operator()(const ref& r) const {
+      return Hash::operator()(*r._key);
+    }
+  };
+
+  struct ref_equal : private Equal {
+    bool operator()(const ref& a, const ref& b) const {
+      return Equal::operator()(*a._key, *b._key);
+    }
+  };
+
+  using index_type = hash_set<ref, 8, ref_hash, ref_equal>;
+
+  index_type                             _index;
+  const uint64_t                         _capacity;
+  std::unique_ptr<std::atomic<entry*>[]> _ring;
+  alignas(64) std::atomic<uint64_t>      _hand;
+  sharded_counter<>                      _hits;
+  sharded_counter<>                      _misses;
+  sharded_counter<>                      _evictions;
+
+  // Drops the mapping unless another thread got there first.
+  bool unmap(entry* const e, const uint64_t tid) {
+    if(e->_dead.exchange(true, std::memory_order_acq_rel))
+      return false;
+    _index.erase(ref{&e->_key, e}, tid);
+    return true;
+  }
+
+  /**
+   * Sweeps the clock until e takes the place of an empty slot, a dead
+   * entry or one not referenced since the hand last passed it.
+   */
+  void place(entry* const e, const uint64_t tid) {
+    while(true) {
+      std::atomic<entry*>& slot = _ring[_hand.fetch_add(1, std::memory_order_relaxed) % _capacity];
+      entry* victim = slot.load(std::memory_order_acquire);
+      if(victim && !victim->_dead.load(std::memory_order_relaxed) &&
+         victim->_referenced.load(std::memory_order_relaxed)) {
+        victim->_referenced.store(false, std::memory_order_relaxed);
+        continue;
+      }
+      if(!slot.compare_exchange_strong(victim, e, std::memory_order_acq_rel))
+        continue;
+      if(victim) {
+        if(unmap(victim, tid))
+          _evictions.add();
+        _index.qs.deferred_delete(victim);
+      }
+      return;
+    }
+  }
+
+public:
+
+  clock_cache(const uint64_t capacity)
+    : _index(capacity / 4 > 16 ? capacity / 4 : 16), _capacity(capacity),
+      _ring(new std::atomic<entry*>[capacity]), _hand(0) {
+    for(uint64_t i = 0; i < capacity; i++)
+      _ring[i].store(nullptr, std::memory_order_relaxed);
+  }
+
+  ~clock_cache() {
+    for(uint64_t i = 0; i < _capacity; i++)
+      delete _ring[i].load();
+  }
+
+  // Same rules as qsbr::register_thread.
+  uint64_t register_thread() {
+    return _index.qs.register_thread();
+  }
+
+  void quiescent(const uint64_t tid) {
+    _index.qs.quiescent(tid);
+  }
+
+  uint64_t capacity() const {
+    return _capacity;
+  }
+
+  /**
+   * Copies the value cached for key into out. If nonblocking is true
+   * this function is wait-free.
+   */
+  bool get(const Key& key, Value& out, const uint64_t tid, const bool nonblocking = true) {
+    ref r;
+    if(!_index.get(ref{&key, nullptr}, r, tid)) {
+      _misses.add();
+      if(!nonblocking)
+        _index.qs.quiescent(tid);
+      return false;
+    }
+    entry* const e = r._entry;
+    // Only write the line if the bit is not set already.
+    if(!e->_referenced.load(std::memory_order_relaxed))
+      e->_referenced.store(true, std::memory_order_relaxed);
+    out = e->_value;
+    _hits.add();
+    if(!nonblocking)
+      _index.qs.quiescent(tid);
+    return true;
+  }
+
+  bool contains(const Key& key, const uint64_t tid, const bool nonblocking = true) const {
+    return _index.find(ref{&key, nullptr}, tid, nonblocking);
+  }
+
+  /**
+   * Caches value for key, evicting another entry if the cache is full.
+   * Returns false, leaving the cache unchanged, if key is present.
+   */
+  bool insert(const Key& key, const Value& value, const uint64_t tid) {
+    entry* const e = new entry(key, value);
+    if(!_index.insert(ref{&e->_key, e}, tid)) {
+      delete e;
+      return false;
+    }
+    place(e, tid);
+    return true;
+  }
+
+  /**
+   * Drops key from the cache. Its slot in the ring is reused the next
+   * time the hand passes it.
+   */
+  bool erase(const Key& key, const uint64_t tid) {
+    ref r;
+    if(!_index.get(ref{&key, nullptr}, r, tid))
+      return false;
+    return unmap(r._entry, tid);
+  }
+
+  int64_t hits() const {
+    return _hits.read();
+  }
+
+  int64_t misses() const {
+    return _misses.read();
+  }
+
+  int64_t evictions() const {
+    return _evictions.read();
+  }
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+
+#include <x86intrin.h>
+
+#include "counters.hpp"
+
+/**
+ * Default instrumentation policy. Every hook is an empty inline function
+ * and the policy is an empty base, so instrumented code compiles to
+ * exactly what it was without it.
+ */
+struct no_stats {
+  void cas_failure() noexcept {}
+  void op_done() noexcept {}
+  void spin(const uint64_t) noexcept {}
+  uint64_t rehash_begin() noexcept { return 0; }
+  void rehash_end(const uint64_t) noexcept {}
+  void full() noexcept {}
+  void empty() noexcept {}
+};
+
+/**
+ * Instrumentation policy counting into padded per-thread cells.
+ *
+ * cas_failure() bumps a per-thread streak which op_done() records as the
+ * retry depth of the operation, so every instrumented operation that can
+ * fail a CAS must end in op_done(). Rehash durations are in TSC ticks.
+ */
+template<size_t Cells = 64>
+struct contention_stats {
+  sharded_counter<Cells> cas_failures;
+  sharded_counter<Cells> spins;
+  sharded_counter<Cells> rehashes;
+  sharded_counter<Cells> fulls;
+  sharded_counter<Cells> empties;
+  log_histogram<>        retry_depth;
+  log_histogram<>        rehash_ticks;
+
+  void cas_failure() {
+    ++streak();
+    cas_failures.add();
+  }
+
+  void op_done() {
+    retry_depth.record(streak());
+    streak() = 0;
+  }
+
+  void spin(const uint64_t n) {
+    if(n)
+      spins.add(n);
+  }
+
+  uint64_t rehash_begin() {
+    return __rdtsc();
+  }
+
+  void rehash_end(const uint64_t start) {
+    rehashes.add();
+    rehash_ticks.record(__rdtsc() - start);
+  }
+
+  void full() {
+    fulls.add();
+  }
+
+  void empty() {
+    empties.add();
+  }
+
+  void reset() {
+    cas_failures.reset();
+    spins.reset();
+    rehashes.reset();
+    fulls.reset();
+    empties.reset();
+    retry_depth.reset();
+    rehash_ticks.reset();
+  }
+
+private:
+
+  static uint64_t& streak() {
+    static thread_local uint64_t n = 0;
+    return n;
+  }
+};
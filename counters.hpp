@@ -0,0 +1,248 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "thread_index.hpp"
+
+/**
+ * Counter sharded over padded per-thread cells. add() is a relaxed
+ * fetch_add on the calling thread's own cache line, read() sums all
+ * cells and is only as consistent as a relaxed snapshot can be.
+ */
+template<size_t Cells = 64>
+class sharded_counter {
+
+  struct alignas(64) cell {
+    std::atomic<int64_t> _value{0};
+  };
+
+  cell _cells[Cells];
+
+public:
+
+  void add(const int64_t n = 1) {
+    _cells[this_thread_index() % Cells]._value.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  sharded_counter& operator++() {
+    add(1);
+    return *this;
+  }
+
+  sharded_counter& operator+=(const int64_t n) {
+    add(n);
+    return *this;
+  }
+
+  int64_t read() const {
+    int64_t sum = 0;
+    for(const cell& c : _cells)
+      sum += c._value.load(std::memory_order_relaxed);
+    return sum;
+  }
+
+  void reset() {
+    for(cell& c : _cells)
+      c._value.store(0, std::memory_order_relaxed);
+  }
+};
+
+/**
+ * Sharded min/max/sum/count gauge.
+ */
+template<size_t Cells = 64>
+class sharded_gauge {
+
+  struct alignas(64) cell {
+    std::atomic<int64_t> _min{std::numeric_limits<int64_t>::max()};
+    std::atomic<int64_t> _max{std::numeric_limits<int64_t>::min()};
+    std::atomic<int64_t> _sum{0};
+    std::atomic<int64_t> _count{0};
+  };
+
+  cell _cells[Cells];
+
+public:
+
+  void record(const int64_t v) {
+    cell& c = _cells[this_thread_index() % Cells];
+    c._sum.fetch_add(v, std::memory_order_relaxed);
+    c._count.fetch_add(1, std::memory_order_relaxed);
+    int64_t min = c._min.load(std::memory_order_relaxed);
+    while(v < min && !c._min.compare_exchange_weak(min, v, std::memory_order_relaxed));
+    int64_t max = c._max.load(std::memory_order_relaxed);
+    while(v > max && !c._max.compare_exchange_weak(max, v, std::memory_order_relaxed));
+  }
+
+  // min() and max() of an empty gauge are INT64_MAX and INT64_MIN.
+  int64_t min() const {
+    int64_t result = std::numeric_limits<int64_t>::max();
+    for(const cell& c : _cells) {
+      const int64_t v = c._min.load(std::memory_order_relaxed);
+      result = v < result ? v : result;
+    }
+    return result;
+  }
+
+  int64_t max() const {
+    int64_t result = std::numeric_limits<int64_t>::min();
+    for(const cell& c : _cells) {
+      const int64_t v = c._max.load(std::memory_order_relaxed);
+      result = v > result ? v : result;
+    }
+    return result;
+  }
+
+  int64_t sum() const {
+    int64_t result = 0;
+    for(const cell& c : _cells)
+      result += c._sum.load(std::memory_order_relaxed);
+    return result;
+  }
+
+  int64_t count() const {
+    int64_t result = 0;
+    for(const cell& c : _cells)
+      result += c._count.load(std::memory_order_relaxed);
+    return result;
+  }
+
+  double mean() const {
+    const int64_t n = count();
+    return n ? static_cast<double>(sum()) / n : 0.0;
+  }
+
+  void reset() {
+    for(cell& c : _cells) {
+      c._min.store(std::numeric_limits<int64_t>::max(), std::memory_order_relaxed);
+      c._max.store(std::numeric_limits<int64_t>::min(), std::memory_order_relaxed);
+      c._sum.store(0, std::memory_order_relaxed);
+      c._count.store(0, std::memory_order_relaxed);
+    }
+  }
+};
+
+/**
+ * Sharded log-linear histogram of unsigned values (e.g. latencies in
+ * cycles). Every power of two is split into 2^SUB_BITS linear buckets,
+ * so a reported percentile is within 1/2^SUB_BITS of the true value.
+ */
+template<size_t Cells = 16>
+class log_histogram {
+
+public:
+
+  static constexpr unsigned SUB_BITS = 3;
+  static constexpr unsigned SUB = 1u << SUB_BITS;
+  static constexpr unsigned BUCKETS = (64 - SUB_BITS + 1) * SUB;
+
+  static unsigned bucket(const uint64_t v) noexcept {
+    if(v < SUB)
+      return v;
+    const unsigned msb = 63 - __builtin_clzl(v);
+    return (msb - SUB_BITS + 1) * SUB + ((v >> (msb - SUB_BITS)) & (SUB - 1));
+  }
+
+  // Smallest value falling in bucket b.
+  static uint64_t lower_bound(const unsigned b) noexcept {
+    if(b < SUB)
+      return b;
+    const unsigned msb = b / SUB + SUB_BITS - 1;
+    return static_cast<uint64_t>(SUB + b % SUB) << (msb - SUB_BITS);
+  }
+
+  // Largest value falling in bucket b.
+  static uint64_t upper_bound(const unsigned b) noexcept {
+    return b + 1 < BUCKETS ? lower_bound(b + 1) - 1 : std::numeric_limits<uint64_t>::max();
+  }
+
+private:
+
+  struct alignas(64) cell {
+    std::atomic<uint64_t> _counts[BUCKETS];
+    std::atomic<uint64_t> _sum{0};
+
+    cell() {
+      for(auto& c : _counts)
+        c.store(0, std::memory_order_relaxed);
+    }
+  };
+
+  cell _cells[Cells];
+
+public:
+
+  void record(const uint64_t v) {
+    cell& c = _cells[this_thread_index() % Cells];
+    c._counts[bucket(v)].fetch_add(1, std::memory_order_relaxed);
+    c._sum.fetch_add(v, std::memory_order_relaxed);
+  }
+
+  uint64_t count(const unsigned b) const {
+    uint64_t n = 0;
+    for(const cell& c : _cells)
+      n += c._counts[b].load(std::memory_order_relaxed);
+    return n;
+  }
+
+  uint64_t count() const {
+    uint64_t n = 0;
+    for(unsigned b = 0; b < BUCKETS; b++)
+      n += count(b);
+    return n;
+  }
+
+  uint64_t sum() const {
+    uint64_t n = 0;
+    for(const cell& c : _cells)
+      n += c._sum.load(std::memory_order_relaxed);
+    return n;
+  }
+
+  double mean() const {
+    const uint64_t n = count();
+    return n ? static_cast<double>(sum()) / n : 0.0;
+  }
+
+  /**
+   * Upper bound of the bucket holding the p-th percentile, p in [0, 100].
+   */
+  uint64_t percentile(const double p) const {
+    uint64_t counts[BUCKETS];
+    uint64_t total = 0;
+    for(unsigned b = 0; b < BUCKETS; b++)
+      total += counts[b] = count(b);
+    if(total == 0)
+      return 0;
+    const uint64_t rank = static_cast<uint64_t>(p / 100.0 * (total - 1)) + 1;
+    uint64_t seen = 0;
+    for(unsigned b = 0; b < BUCKETS; b++) {
+      seen += counts[b];
+      if(seen >= rank)
+        return upper_bound(b);
+    }
+    return upper_bound(BUCKETS - 1);
+  }
+
+  /**
+   * Adds the contents of o into this histogram.
+   */
+  template<size_t OtherCells>
+  void merge(const log_histogram<OtherCells>& o) {
+    cell& c = _cells[this_thread_index() % Cells];
+    for(unsigned b = 0; b < BUCKETS; b++)
+      c._counts[b].fetch_add(o.count(b), std::memory_order_relaxed);
+    c._sum.fetch_add(o.sum(), std::memory_order_relaxed);
+  }
+
+  void reset() {
+    for(cell& c : _cells) {
+      for(auto& n : c._counts)
+        n.store(0, std::memory_order_relaxed);
+      c._sum.store(0, std::memory_order_relaxed);
+    }
+  }
+};
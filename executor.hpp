@@ -0,0 +1,192 @@
+#pragma once
+
+#include "gc.hpp"
+#include "mpsc_queue.hpp"
+#include "spin_lock.hpp"
+#include "work_stealing_deque.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Work-stealing task executor.
+ *
+ * Each worker owns a work_stealing_deque. Tasks submitted from a worker
+ * go to its own deque, tasks from any other thread go through a shared
+ * mpsc_queue injection queue. Idle workers steal from random victims,
+ * then yield and finally park until the next submit().
+ * Can only run a maximum of upto 64 workers (a qsbr limit).
+ */
+class executor {
+
+  using task = std::function<void()>;
+
+  static constexpr unsigned QUIESCE_INTERVAL = 64;
+  static constexpr unsigned SPINS_BEFORE_YIELD = 64;
+  static constexpr unsigned YIELDS_BEFORE_PARK = 64;
+
+  struct alignas(64) worker {
+    work_stealing_deque<task*> _deque;
+    uint64_t    _tid;
+    uint64_t    _rng;
+    std::thread _thread;
+
+    worker(qsbr& qs, const uint64_t tid) : _deque(qs), _tid(tid), _rng(tid * 0x9E3779B97F4A7C15ul + 1) {}
+
+    uint64_t next_random() noexcept {
+      _rng ^= _rng << 13;
+      _rng ^= _rng >> 7;
+      _rng ^= _rng << 17;
+      return _rng;
+    }
+  };
+
+  qsbr _qs;
+  std::vector<std::unique_ptr<worker>> _workers;
+  mpsc_queue<task*> _injection;
+  spin_lock         _injection_lock; // mpsc_queue has a single consumer
+  std::atomic<bool>    _stop;
+  std::atomic<int64_t> _pending;
+  std::atomic<unsigned> _parked;
+  mutable std::mutex              _park_lock;
+  std::condition_variable         _work_cv; // parked workers
+  mutable std::condition_variable _done_cv; // wait()
+
+  static thread_local const executor* tl_owner;
+  static thread_local worker*         tl_worker;
+
+  bool pop_injected(task*& t) {
+    if(!_injection_lock.try_lock())
+      return false;
+    const bool result = _injection.pop(t);
+    _injection_lock.unlock();
+    return result;
+  }
+
+  bool steal(worker& self, task*& t) {
+    const size_t n = _workers.size();
+    const size_t start = self.next_random() % n;
+    for(size_t i = 0; i < n; i++) {
+      worker& victim = *_workers[(start + i) % n];
+      if(&victim != &self && victim._deque.steal(t))
+        return true;
+    }
+    return false;
+  }
+
+  // Sleeps until submit() or ~executor() wakes us. The worker announces
+  // itself in _parked before its last look for work, and submit() checks
+  // _parked after publishing a task, so one of the two always sees the other.
+  bool park(worker& self, task*& t) {
+    std::unique_lock<std::mutex> lock(_park_lock);
+    _parked.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const bool found = self._deque.pop(t) || pop_injected(t) || steal(self, t);
+    if(!found && !_stop.load(std::memory_order_acquire))
+      _work_cv.wait(lock);
+    _parked.fetch_sub(1, std::memory_order_relaxed);
+    return found;
+  }
+
+  void wake() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(_parked.load(std::memory_order_relaxed) == 0)
+      return;
+    std::lock_guard<std::mutex> lock(_park_lock);
+    _work_cv.notify_one();
+  }
+
+  void run(worker& self) {
+    tl_owner = this;
+    tl_worker = &self;
+    unsigned idle = 0;
+    unsigned since_quiescent = 0;
+    while(true) {
+      task* t;
+      if(self._deque.pop(t) || pop_injected(t) || steal(self, t) ||
+         (idle >= SPINS_BEFORE_YIELD + YIELDS_BEFORE_PARK && park(self, t))) {
+        idle = 0;
+        (*t)();
+        delete t;
+        if(_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+          std::lock_guard<std::mutex> lock(_park_lock);
+          _done_cv.notify_all();
+        }
+        if(++since_quiescent < QUIESCE_INTERVAL)
+          continue;
+      }
+      else if(_stop.load(std::memory_order_acquire)) {
+        break;
+      }
+      else if(++idle < SPINS_BEFORE_YIELD) {
+        asm("pause");
+      }
+      else {
+        std::this_thread::yield();
+      }
+      since_quiescent = 0;
+      _qs.quiescent(self._tid);
+    }
+    tl_owner = nullptr;
+    tl_worker = nullptr;
+  }
+
+public:
+
+  executor(const unsigned nthreads = std::thread::hardware_concurrency()) : _stop(false), _pending(0), _parked(0) {
+    const unsigned n = nthreads ? nthreads : 1;
+    for(unsigned i = 0; i < n; i++)
+      _workers.emplace_back(new worker(_qs, _qs.register_thread()));
+    for(auto& w : _workers)
+      w->_thread = std::thread(&executor::run, this, std::ref(*w));
+  }
+
+  ~executor() {
+    wait();
+    _stop.store(true, std::memory_order_release);
+    {
+      std::lock_guard<std::mutex> lock(_park_lock);
+      _work_cv.notify_all();
+    }
+    for(auto& w : _workers)
+      w->_thread.join();
+  }
+
+  size_t size() const noexcept {
+    return _workers.size();
+  }
+
+  // Can be called from any thread, including from within a task.
+  void submit(task fn) {
+    _pending.fetch_add(1, std::memory_order_relaxed);
+    task* t = new task(std::move(fn));
+    if(tl_owner == this)
+      tl_worker->_deque.push(t);
+    else
+      _injection.push(t);
+    wake();
+  }
+
+  // Waits until every submitted task, including tasks they spawned, has run.
+  // Must not be called from within a task.
+  void wait() const {
+    for(unsigned i = 0; i < SPINS_BEFORE_YIELD + YIELDS_BEFORE_PARK; i++) {
+      if(_pending.load(std::memory_order_acquire) <= 0)
+        return;
+      if(i < SPINS_BEFORE_YIELD)
+        asm("pause");
+      else
+        std::this_thread::yield();
+    }
+    std::unique_lock<std::mutex> lock(_park_lock);
+    _done_cv.wait(lock, [this] { return _pending.load(std::memory_order_acquire) <= 0; });
+  }
+};
+
+inline thread_local const executor* executor::tl_owner = nullptr;
+inline thread_local executor::worker* executor::tl_worker = nullptr;
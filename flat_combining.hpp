@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "spin_lock.hpp"
+
+/**
+ * Flat combining wrapper around a sequential container.
+ *
+ * Each registered thread owns a padded publication slot. A thread posts
+ * its operation in its slot and then either waits for the result or, if
+ * it wins the combiner lock, applies every pending operation in one pass
+ * while the container is hot in its cache.
+ *
+ * Op is a callable taking Container& and returning a default
+ * constructible result. Lock may be spin_lock, easy_mcs_lock<>, etc.
+ * Registering more than MaxThreads threads fails an assert.
+ */
+template<typename Container,
+         typename Op,
+         typename Lock = spin_lock,
+         size_t MaxThreads = 64>
+class flat_combining : private Lock {
+
+  using result_type = decltype(std::declval<Op&>()(std::declval<Container&>()));
+
+  struct alignas(64) slot {
+    std::atomic<bool> _pending{false};
+    Op          _op;
+    result_type _result;
+  };
+
+  Container             _container;
+  std::atomic<uint64_t> _counter;
+  slot                  _slots[MaxThreads];
+
+  void combine() {
+    const uint64_t n = _counter.load(std::memory_order_acquire);
+    for(uint64_t i = 0; i < n && i < MaxThreads; i++) {
+      slot& s = _slots[i];
+      if(s._pending.load(std::memory_order_acquire)) {
+        s._result = s._op(_container);
+        s._pending.store(false, std::memory_order_release);
+      }
+    }
+  }
+
+public:
+
+  template<typename... Args>
+  flat_combining(Args&&... args) : _container(std::forward<Args>(args)...), _counter(0) {}
+
+  // Can only register a maximum of upto MaxThreads threads.
+  uint64_t register_thread() {
+    const uint64_t tid = _counter.fetch_add(1, std::memory_order_acq_rel);
+    assert(tid < MaxThreads);
+    return tid;
+  }
+
+  result_type apply(Op op, const uint64_t tid) {
+    assert(tid < MaxThreads);
+    slot& s = _slots[tid];
+    s._op = std::move(op);
+    s._pending.store(true, std::memory_order_release);
+    while(s._pending.load(std::memory_order_acquire)) {
+      if(Lock::try_lock()) {
+        combine();
+        Lock::unlock();
+      }
+      else {
+        asm("pause");
+      }
+    }
+    return std::move(s._result);
+  }
+
+  /**
+   * Direct access, only safe while no other thread calls apply.
+   */
+  Container& unsafe_container() noexcept {
+    return _container;
+  }
+};
@@ -1,23 +1,56 @@
 #pragma once
 
+#include "contention_stats.hpp"
 #include "gc.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
 #include <cstring>
+#include <memory>
+#include <thread>
 #include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 template<typename T, size_t N>
 static void remove_at(T(&arr)[N], size_t index) {
   std::memmove(arr + index, arr + index + 1, sizeof(T) * (N - index - 1));
 }
 
+/**
+ * Default hash_set Filter policy, every key may be present.
+ */
+struct no_filter {
+  explicit no_filter(const size_t) noexcept {}
+  bool may_contain(const size_t) const noexcept { return true; }
+  void add(const size_t) noexcept {}
+  void rebuild_begin(const size_t) noexcept {}
+  void rebuild_add(const size_t) noexcept {}
+  void rebuild_end(qsbr&) noexcept {}
+};
+
 /**
  * Bucket based hash set with CoW buckets.
+ *
+ * Stats is an instrumentation policy (see contention_stats.hpp), the
+ * default no_stats compiles to nothing. Allocator, rebound as needed,
+ * provides the bucket pointer array, e.g. a numa_allocator. Filter is
+ * consulted by find() before the table, e.g. bloom_front to answer most
+ * misses from a single cache line.
  */
 template <typename T,
          unsigned BUCKET_SIZE = 8,
          typename Hash = std::hash<T>,
-         typename Equal = std::equal_to<T>>
-class hash_set : private Hash, Equal {
+         typename Equal = std::equal_to<T>,
+         typename Stats = no_stats,
+         typename Allocator = std::allocator<T>,
+         typename Filter = no_filter>
+class hash_set : private Hash, Equal, Stats, Filter {
 
   static_assert(std::is_trivially_copyable<T>::value, "T must be trivially_copyable!");
   static_assert(std::is_trivially_destructible<T>::value, "T must be trivially_destructible!");
@@ -83,6 +116,99 @@ class hash_set : private Hash, Equal {
 
   static_assert(std::is_trivially_copyable<T>::value, "T is not TC!");
 
+  using bucket_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<std::atomic<bucket*>>;
+
+  /**
+   * Retired bucket array, handed back to the allocator by qsbr.
+   */
+  struct bucket_array : public collectable {
+    bucket_allocator      _alloc;
+    std::atomic<bucket*>* _buckets;
+    size_t                _size;
+
+    bucket_array(const bucket_allocator& alloc, std::atomic<bucket*>* buckets, size_t size)
+      : collectable(), _alloc(alloc), _buckets(buckets), _size(size) {}
+
+    virtual ~bucket_array() override {
+      _alloc.deallocate(_buckets, _size);
+    }
+  };
+
+  bucket_allocator _alloc;
+
+  std::atomic<bucket*>* new_buckets(const size_t count) {
+    std::atomic<bucket*>* const buckets = _alloc.allocate(count);
+    for(size_t i = 0; i < count; i++)
+      new (buckets + i) std::atomic<bucket*>(new bucket);
+    return buckets;
+  }
+
+  void delete_buckets(std::atomic<bucket*>* const buckets, const size_t count) {
+    for(size_t i = 0; i < count; i++)
+      delete buckets[i].load(std::memory_order_relaxed);
+    _alloc.deallocate(buckets, count);
+  }
+
+  /**
+   * dump() file layout, a header followed by one fixed size record per
+   * bucket so that an image can be probed in place.
+   */
+  static constexpr uint64_t IMAGE_MAGIC = 0x3154455348534148ul; // "HASHSET1"
+
+  struct image_header {
+    uint64_t _magic;
+    uint64_t _bucket_size;
+    uint64_t _item_size;
+    uint64_t _slot_size;
+    uint64_t _modulus;
+    uint64_t _count;
+    uint64_t _pad[2];
+  };
+
+  struct image_record {
+    uint64_t _size;
+    typename std::aligned_storage<sizeof(slot), alignof(slot)>::type _items[BUCKET_SIZE];
+  };
+
+  static bool check(const image_header& h, const size_t bytes) {
+    return h._magic == IMAGE_MAGIC && h._bucket_size == BUCKET_SIZE &&
+      h._item_size == sizeof(T) && h._slot_size == sizeof(slot) &&
+      h._modulus != 0 && (h._modulus & (h._modulus - 1)) == 0 &&
+      bytes == sizeof(image_header) + h._modulus * sizeof(image_record);
+  }
+
+  // Runs fn(0) to fn(threads - 1), fn(0) on the calling thread.
+  template<typename Func>
+  static void parallel(const unsigned threads, Func&& fn) {
+    std::vector<std::thread> workers;
+    for(unsigned t = 1; t < threads; t++)
+      workers.emplace_back(fn, t);
+    fn(0);
+    for(auto& w : workers)
+      w.join();
+  }
+
+  /**
+   * Swaps in a complete table, freeing the current one on the spot. No
+   * other thread may be using the set.
+   */
+  void install(std::atomic<bucket*>* const buckets, const size_t modulus, const unsigned threads) {
+    Filter::rebuild_begin(modulus * BUCKET_SIZE);
+    parallel(threads, [&](const unsigned t) {
+      for(size_t i = modulus * t / threads; i < modulus * (t + 1) / threads; i++) {
+        const bucket* const b = buckets[i].load(std::memory_order_relaxed);
+        for(unsigned j = 0; j < b->_size; j++)
+          Filter::rebuild_add((*b)[j]._hash);
+      }
+    });
+    Filter::rebuild_end(qs);
+    size_t old_modulus;
+    std::atomic<bucket*>* old;
+    unzip(old, old_modulus);
+    delete_buckets(old, old_modulus);
+    zip(buckets, modulus);
+  }
+
   /**
    * Locks a bucket ensuring all further CAS operations fail.
    */
@@ -121,27 +247,270 @@ public:
   std::atomic_bool      _rehashing;
   std::atomic_uintptr_t _top;
 
-  hash_set(size_t bcount = 16) {
-    using bucket_ptr_t = std::atomic<bucket*>*;
-    auto* const buckets = static_cast<bucket_ptr_t>(std::calloc(sizeof(bucket_ptr_t), bcount));
-    for(size_t i = 0; i < bcount; i++)
-      buckets[i].store(new bucket);
-    zip(buckets, bcount);
+  hash_set(size_t bcount = 16, const Allocator& alloc = Allocator())
+    : Filter(bcount * BUCKET_SIZE), _alloc(alloc), _rehashing(false) {
+    zip(new_buckets(bcount), bcount);
   }
 
   ~hash_set() {
     size_t modulus;
     std::atomic<bucket*>* buckets;
     unzip(buckets, modulus);
-    for(size_t i = 0; i < modulus; i++) {
-      delete buckets[i].load();
+    delete_buckets(buckets, modulus);
+  }
+
+  /**
+   * Read-only view of a dump() file mapped straight into memory. Nothing
+   * is copied and pages are only read in as lookups touch them, lookups
+   * are wait-free and need no qsbr.
+   */
+  class image : private Hash, Equal {
+    friend class hash_set;
+
+    void*               _map = MAP_FAILED;
+    size_t              _bytes = 0;
+    const image_header* _header = nullptr;
+    const image_record* _records = nullptr;
+
+  public:
+
+    explicit image(const char* const path) {
+      const int fd = ::open(path, O_RDONLY);
+      if(fd < 0)
+        return;
+      struct stat st;
+      if(::fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(image_header)) {
+        _bytes = st.st_size;
+        _map = ::mmap(nullptr, _bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+      }
+      ::close(fd);
+      if(_map == MAP_FAILED)
+        return;
+      const image_header* const h = static_cast<const image_header*>(_map);
+      if(check(*h, _bytes)) {
+        _header = h;
+        _records = reinterpret_cast<const image_record*>(h + 1);
+      }
+    }
+
+    image(const image&) = delete;
+    image& operator=(const image&) = delete;
+
+    ~image() {
+      if(_map != MAP_FAILED)
+        ::munmap(_map, _bytes);
+    }
+
+    bool valid() const noexcept {
+      return _header != nullptr;
+    }
+
+    size_t size() const noexcept {
+      return _header->_count;
+    }
+
+    bool get(const T& value, T& out) const {
+      const size_t hash = Hash::operator()(value);
+      const image_record& r = _records[hash & (_header->_modulus - 1)];
+      const size_t n = r._size < BUCKET_SIZE ? r._size : BUCKET_SIZE;
+      for(size_t i = 0; i < n; i++) {
+        const slot& s = *reinterpret_cast<const slot*>(r._items + i);
+        if(s._hash == hash && Equal::operator()(s._item, value)) {
+          out = s._item;
+          return true;
+        }
+      }
+      return false;
     }
-    free(buckets);
+
+    bool find(const T& value) const {
+      T out;
+      return get(value, out);
+    }
+  };
+
+  /**
+   * Replaces the contents with the elements in the random access range
+   * [first, last). The table is sized up front and threads threads fill
+   * it directly, each owning a contiguous range of buckets, without any
+   * copy-on-write or retirement. Items are partitioned by owner once, a
+   * histogram then a scatter, so each thread only touches its own. No
+   * other thread may use the set meanwhile.
+   */
+  template<typename Iterator>
+  void bulk_build(const Iterator first, const Iterator last, unsigned threads = 1) {
+    threads = threads ? threads : 1;
+    const size_t count = last - first;
+    std::vector<size_t> hashes(count);
+    std::vector<size_t> order(count);
+    // offsets[t * threads + o]: items of thread t's share going to owner o
+    std::vector<size_t> offsets(threads * threads);
+
+    size_t modulus = 16;
+    while(modulus * BUCKET_SIZE < 2 * count)
+      modulus <<= 1;
+    bool hashed = false;
+    while(true) {
+      // Owner o holds buckets [lo(o), lo(o + 1)), i.e. bucket b goes to b * threads / modulus.
+      const auto lo = [modulus, threads](const size_t o) { return (o * modulus + threads - 1) / threads; };
+      const auto owner = [modulus, threads](const size_t hash) { return (hash & (modulus - 1)) * threads / modulus; };
+
+      std::fill(offsets.begin(), offsets.end(), 0);
+      parallel(threads, [&](const unsigned t) {
+        size_t* const counts = &offsets[t * threads];
+        for(size_t i = count * t / threads; i < count * (t + 1) / threads; i++) {
+          if(!hashed)
+            hashes[i] = Hash::operator()(first[i]);
+          counts[owner(hashes[i])]++;
+        }
+      });
+      hashed = true;
+      // Exclusive prefix sum in owner major order, each owner's items end up contiguous.
+      size_t sum = 0;
+      for(unsigned o = 0; o < threads; o++) {
+        for(unsigned t = 0; t < threads; t++) {
+          const size_t n = offsets[t * threads + o];
+          offsets[t * threads + o] = sum;
+          sum += n;
+        }
+      }
+      std::vector<size_t> starts(threads + 1);
+      for(unsigned o = 0; o < threads; o++)
+        starts[o] = offsets[o];
+      starts[threads] = count;
+      parallel(threads, [&](const unsigned t) {
+        size_t* const next = &offsets[t * threads];
+        for(size_t i = count * t / threads; i < count * (t + 1) / threads; i++)
+          order[next[owner(hashes[i])]++] = i;
+      });
+
+      std::atomic<bucket*>* const buckets = _alloc.allocate(modulus);
+      std::atomic<bool> overflow(false);
+      parallel(threads, [&](const unsigned o) {
+        for(size_t b = lo(o); b < lo(o + 1); b++)
+          new (buckets + b) std::atomic<bucket*>(new bucket);
+        for(size_t k = starts[o]; k < starts[o + 1]; k++) {
+          const size_t i = order[k];
+          bucket* const b = buckets[hashes[i] & (modulus - 1)].load(std::memory_order_relaxed);
+          if(b->find(first[i], hashes[i]) >= 0)
+            continue; // duplicate
+          if(b->full() || overflow.load(std::memory_order_relaxed)) {
+            overflow.store(true, std::memory_order_relaxed);
+            return;
+          }
+          b->insert(first[i], hashes[i]);
+        }
+      });
+      if(!overflow.load()) {
+        install(buckets, modulus, threads);
+        return;
+      }
+      delete_buckets(buckets, modulus);
+      modulus <<= 1;
+    }
+  }
+
+  /**
+   * Writes the table to path in the format read by load() and image. The
+   * dump is only a consistent snapshot if no thread modifies the set.
+   * Items are written byte for byte, so T must be trivially copyable and
+   * hold no pointers for the dump to be meaningful to another process.
+   */
+  bool dump(const char* const path, const uint64_t tid) const {
+    std::FILE* const f = std::fopen(path, "wb");
+    if(!f)
+      return false;
+    size_t modulus;
+    std::atomic<bucket*>* buckets;
+    unzip(buckets, modulus);
+    image_header h;
+    std::memset(&h, 0, sizeof(h));
+    h._magic = IMAGE_MAGIC;
+    h._bucket_size = BUCKET_SIZE;
+    h._item_size = sizeof(T);
+    h._slot_size = sizeof(slot);
+    h._modulus = modulus;
+    bool ok = std::fwrite(&h, sizeof(h), 1, f) == 1;
+    image_record r;
+    for(size_t i = 0; ok && i < modulus; i++) {
+      const bucket* const b = strip_lock(buckets[i]);
+      std::memset(&r, 0, sizeof(r));
+      r._size = b->_size;
+      std::memcpy(r._items, b->_items, sizeof(slot) * r._size);
+      h._count += r._size;
+      ok = std::fwrite(&r, sizeof(r), 1, f) == 1;
+    }
+    qs.quiescent(tid);
+    ok = ok && std::fseek(f, 0, SEEK_SET) == 0 && std::fwrite(&h, sizeof(h), 1, f) == 1;
+    return std::fclose(f) == 0 && ok;
+  }
+
+  /**
+   * Replaces the contents with a dump() file, building buckets on threads
+   * threads. Returns false, leaving the set unchanged, if path is not a
+   * dump of a set of this type. No other thread may use the set meanwhile.
+   */
+  bool load(const char* const path, unsigned threads = 1) {
+    threads = threads ? threads : 1;
+    const image view(path);
+    if(!view.valid())
+      return false;
+    ::madvise(view._map, view._bytes, MADV_WILLNEED);
+    const size_t modulus = view._header->_modulus;
+    std::atomic<bucket*>* const buckets = _alloc.allocate(modulus);
+    std::atomic<bool> corrupt(false);
+    parallel(threads, [&](const unsigned t) {
+      for(size_t i = modulus * t / threads; i < modulus * (t + 1) / threads; i++) {
+        const image_record& r = view._records[i];
+        bucket* const b = new bucket;
+        if(r._size <= BUCKET_SIZE) {
+          b->_size = r._size;
+          std::memcpy(b->_items, r._items, sizeof(slot) * r._size);
+        }
+        else
+          corrupt.store(true, std::memory_order_relaxed);
+        new (buckets + i) std::atomic<bucket*>(b);
+      }
+    });
+    if(corrupt.load()) {
+      delete_buckets(buckets, modulus);
+      return false;
+    }
+    install(buckets, modulus, threads);
+    return true;
+  }
+
+  const Stats& stats() const noexcept {
+    return *this;
+  }
+
+  Stats& stats() noexcept {
+    return *this;
+  }
+
+  /**
+   * Snapshot of how many buckets hold 0..BUCKET_SIZE items. Only exact
+   * when no thread is modifying the set.
+   */
+  void occupancy(uint64_t (&counts)[BUCKET_SIZE + 1], const uint64_t tid) const {
+    size_t modulus;
+    std::atomic<bucket*>* buckets;
+    unzip(buckets, modulus);
+    for(unsigned i = 0; i <= BUCKET_SIZE; i++)
+      counts[i] = 0;
+    for(size_t i = 0; i < modulus; i++)
+      counts[strip_lock(buckets[i])->_size]++;
+    qs.quiescent(tid);
   }
 
   // If nonblocking is true this function is wait-free
   bool find(const T& value, const uint64_t tid, const bool nonblocking = true) const {
     const size_t  hash = Hash::operator()(value);
+    if(!Filter::may_contain(hash)) {
+      if(!nonblocking)
+        qs.quiescent(tid);
+      return false;
+    }
     size_t modulus;
     std::atomic<bucket*>* buckets;
     unzip(buckets, modulus);
@@ -153,9 +522,36 @@ public:
     return result >= 0;
   }
 
+  /**
+   * Like find() but copies the stored element equal to value into out,
+   * for elements which compare equal on only part of their contents.
+   */
+  bool get(const T& value, T& out, const uint64_t tid, const bool nonblocking = true) const {
+    const size_t  hash = Hash::operator()(value);
+    bool result = false;
+    if(Filter::may_contain(hash)) {
+      size_t modulus;
+      std::atomic<bucket*>* buckets;
+      unzip(buckets, modulus);
+      const bucket* const b = strip_lock(buckets[hash & (modulus - 1)]);
+      const int index = b->find(value, hash);
+      if(index >= 0) {
+        out = (*b)[index]._item;
+        result = true;
+      }
+    }
+    if(!nonblocking)
+      qs.quiescent(tid);
+    return result;
+  }
+
   bool insert(const T& value, const uint64_t tid, bucket* prealloc = nullptr) {
-    while(_rehashing.load(std::memory_order_acquire))
+    uint64_t spins = 0;
+    while(_rehashing.load(std::memory_order_acquire)) {
       asm("pause");
+      spins++;
+    }
+    Stats::spin(spins);
     const size_t hash = Hash::operator()(value);
     size_t modulus;
     std::atomic<bucket*>* buckets;
@@ -167,10 +563,12 @@ public:
       // copy bucket
       bucket* copy = prealloc ? new (prealloc) bucket(*old) : new bucket(*old);
       copy->insert(value, hash);
+      Filter::add(hash); // before the item becomes visible
       if(buckets[bucknum].compare_exchange_strong(old, copy, std::memory_order_acq_rel)) {
         qs.deferred_delete(old);
       }
       else {
+        Stats::cas_failure();
         return insert(value, tid, copy);
       }
     }
@@ -181,13 +579,18 @@ public:
     else
       delete prealloc;
 
+    Stats::op_done();
     qs.quiescent(tid);
-    return false;
+    return index == -1;
   }
 
   bool erase(const T& value, const uint64_t tid, bucket* prealloc = nullptr) {
-    while(_rehashing.load(std::memory_order_acquire))
+    uint64_t spins = 0;
+    while(_rehashing.load(std::memory_order_acquire)) {
       asm("pause");
+      spins++;
+    }
+    Stats::spin(spins);
     const size_t hash = Hash::operator()(value);
     size_t modulus;
     std::atomic<bucket*>* buckets;
@@ -203,12 +606,14 @@ public:
         qs.deferred_delete(old);
       }
       else {
+        Stats::cas_failure();
         return erase(value, tid, copy);
       }
     }
     else
       delete prealloc;
 
+    Stats::op_done();
     qs.quiescent(tid);
     return index >= 0;
   }
@@ -218,15 +623,13 @@ public:
     if(prev)
       return false; // someone is already rehashing
 
+    const uint64_t start = Stats::rehash_begin();
     size_t modulus;
     std::atomic<bucket*>* buckets;
     unzip(buckets, modulus);
 
-    using bucket_ptr_t = std::atomic<bucket*>*;
-    auto* const newb = static_cast<bucket_ptr_t>(std::calloc(sizeof(bucket_ptr_t), modulus << 1));
-    for(size_t i = 0; i < (modulus << 1); i++) {
-      newb[i].store(new bucket, std::memory_order_relaxed);
-    }
+    std::atomic<bucket*>* const newb = new_buckets(modulus << 1);
+    Filter::rebuild_begin((modulus << 1) * BUCKET_SIZE);
     for(size_t i = 0; i < modulus; i++) {
       // This "lock" ensures pending erasures/insertions are either
       // observered by this thread or fail.
@@ -238,11 +641,14 @@ public:
           throw 0; //TODO: Try Again
         else
           newbucket.insert(oldslot);
+        Filter::rebuild_add(oldslot._hash);
       }
       qs.deferred_delete(reinterpret_cast<bucket*>(reinterpret_cast<uintptr_t>(b) & ~LOCK_BIT));
     }
-    qs.deferred_free(buckets);
+    qs.deferred_delete(new bucket_array(_alloc, buckets, modulus));
+    Filter::rebuild_end(qs);
     zip(newb, modulus << 1);
+    Stats::rehash_end(start);
     _rehashing.store(false, std::memory_order_release);
     return true;
   }
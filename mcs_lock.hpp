@@ -0,0 +1,166 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <sched.h>
+
+#include "spin_lock.hpp"
+
+/**
+ * Queue node for the MCS lock, one per waiting thread.
+ *
+ * Referred to as struct mlock since <sys/mman.h> declares a function
+ * mlock() which would otherwise hide it.
+ */
+struct mlock {
+  std::atomic<mlock*> _next;
+  std::atomic_bool  _locked;
+
+  mlock() : _next(nullptr), _locked(true) {}
+
+  void reset() {
+    _next.store(nullptr, std::memory_order_relaxed);
+    _locked.store(true,  std::memory_order_relaxed);
+  }
+};
+
+/**
+ * Mellor-Crummey Scott queue lock.
+ * Each waiter spins on its own node.
+ */
+class mcs_lock {
+  std::atomic<struct mlock*>   _tail;
+public:
+
+  mcs_lock() : _tail(nullptr) {}
+
+  void lock(struct mlock& m) {
+    // The node must be reset before it is published, otherwise our
+    // predecessor may link itself in (or unlock us) before the reset.
+    m.reset();
+    struct mlock* old = _tail.exchange(&m, std::memory_order_acq_rel);
+    if(old) {
+      old->_next.store(&m, std::memory_order_release);
+      while(m._locked.load(std::memory_order_acquire))
+        asm("pause");
+    }
+  }
+
+  bool try_lock(struct mlock& m) {
+    m.reset();
+    struct mlock* expected = nullptr;
+    return _tail.compare_exchange_strong(expected, &m, std::memory_order_acq_rel);
+  }
+
+  void unlock(struct mlock& m) {
+    struct mlock* expected = &m;
+    if(!_tail.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel)) {
+      while(!m._next.load(std::memory_order_acquire)) // next is a nullptr
+        asm("pause");
+      m._next.load(std::memory_order_relaxed)->_locked.store(false, std::memory_order_release);
+    }
+  }
+
+  // Only meaningful for the current holder of the lock.
+  bool has_waiters(const struct mlock& m) const {
+    return _tail.load(std::memory_order_acquire) != &m;
+  }
+};
+
+template<size_t TagNumber = 0>
+class easy_mcs_lock : private mcs_lock {
+  static thread_local struct mlock m;
+public:
+
+  void lock() {
+    mcs_lock::lock(m);
+  }
+
+  bool try_lock() {
+    return mcs_lock::try_lock(m);
+  }
+
+  void unlock() {
+    mcs_lock::unlock(m);
+  }
+};
+
+template<size_t TagNumber>
+thread_local struct mlock easy_mcs_lock<TagNumber>::m;
+
+/**
+ * NUMA-aware cohort lock (C-TKT-MCS style).
+ *
+ * Threads first queue on an MCS lock local to their NUMA node. The
+ * winner of the local lock then takes the global lock, which is a
+ * thread-oblivious spin_lock so that it may be released by a different
+ * thread on the same node. On unlock the global lock is handed to a
+ * local waiter, without ever being released, up to MaxPasses times in a
+ * row before it is released to let the other nodes in.
+ */
+template<size_t Nodes = 4, unsigned MaxPasses = 64>
+class cohort_lock {
+
+  struct alignas(64) cohort {
+    mcs_lock _local;
+    // Only accessed by the holder of _local.
+    bool     _owns_global = false;
+    unsigned _passes = 0;
+  };
+
+  spin_lock _global;
+  // Only accessed by the holder of the lock.
+  unsigned  _holder = 0;
+  cohort    _cohorts[Nodes];
+
+  static unsigned current_node() {
+    unsigned cpu = 0, node = 0;
+    if(getcpu(&cpu, &node) != 0)
+      return 0;
+    return node % Nodes;
+  }
+
+public:
+
+  void lock(struct mlock& m) {
+    const unsigned node = current_node();
+    cohort& c = _cohorts[node];
+    c._local.lock(m);
+    if(!c._owns_global) {
+      _global.lock();
+      c._owns_global = true;
+      c._passes = 0;
+    }
+    _holder = node;
+  }
+
+  void unlock(struct mlock& m) {
+    cohort& c = _cohorts[_holder];
+    if(c._local.has_waiters(m) && ++c._passes < MaxPasses) {
+      // Pass the global lock along with the local one.
+      c._local.unlock(m);
+      return;
+    }
+    c._owns_global = false;
+    _global.unlock();
+    c._local.unlock(m);
+  }
+};
+
+template<size_t TagNumber = 0, size_t Nodes = 4, unsigned MaxPasses = 64>
+class easy_cohort_lock : private cohort_lock<Nodes, MaxPasses> {
+  using base = cohort_lock<Nodes, MaxPasses>;
+  static thread_local struct mlock m;
+public:
+
+  void lock() {
+    base::lock(m);
+  }
+
+  void unlock() {
+    base::unlock(m);
+  }
+};
+
+template<size_t TagNumber, size_t Nodes, unsigned MaxPasses>
+thread_local struct mlock easy_cohort_lock<TagNumber, Nodes, MaxPasses>::m;
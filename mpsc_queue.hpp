@@ -1,10 +1,16 @@
 #pragma once
 
 #include <atomic>
+#include <memory>
 #include <utility>
 
-template <typename T>
-class mpsc_queue {
+#include "contention_stats.hpp"
+
+/**
+ * Stats counts pop() on an empty queue.
+ */
+template <typename T, typename Allocator = std::allocator<T>, typename Stats = no_stats>
+class mpsc_queue : private Stats {
 
   struct node {
     std::atomic<node*> _next;
@@ -14,22 +20,38 @@ class mpsc_queue {
     node(T&& movable) : _next(nullptr), _value(std::move(movable)) {}
   };
 
+  using node_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<node>;
+
+  node_allocator     _alloc; // before _head and _tail, whose initialisers allocate
   std::atomic<node*> _head;
   std::atomic<node*> _tail;
 
+  template<typename... Args>
+  node* new_node(Args&&... args) {
+    node* n = _alloc.allocate(1);
+    return new (n) node(std::forward<Args>(args)...);
+  }
+
+  void delete_node(node* n) {
+    n->~node();
+    _alloc.deallocate(n, 1);
+  }
+
 public:
 
-  mpsc_queue() : _head(new node), _tail(_head.load()) {}
+  mpsc_queue() : _head(new_node()), _tail(_head.load()) {}
+
+  explicit mpsc_queue(const Allocator& alloc) : _alloc(alloc), _head(new_node()), _tail(_head.load()) {}
 
   bool push(const T& value) {
-    node* n = new node(value);
+    node* n = new_node(value);
     node* old = _tail.exchange(n, std::memory_order_acq_rel);
     old->_next.store(n, std::memory_order_release);
     return true;
   }
 
   bool push(T&& value) {
-    node* n = new node(std::move(value));
+    node* n = new_node(std::move(value));
     node* old = _tail.exchange(n, std::memory_order_acq_rel);
     old->_next.store(n, std::memory_order_release);
     return true;
@@ -40,14 +62,19 @@ public:
     node* next = head->_next.load(std::memory_order_acquire);
     if(next) {
       _head.store(next, std::memory_order_relaxed);
-      delete head;
+      delete_node(head);
       value = std::move(next->_value);
       return true;
     }
+    Stats::empty();
     return false;
   }
 
+  const Stats& stats() const noexcept {
+    return *this;
+  }
+
   ~mpsc_queue() {
-    delete _head.load();
+    delete_node(_head.load());
   }
 };
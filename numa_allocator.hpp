@@ -0,0 +1,115 @@
+#pragma once
+
+#include "pages.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+enum class numa_policy {
+  first_touch, // kernel default, pages land on the node that touches them first
+  bind,        // all pages on one node
+  interleave   // pages round robin over every node we may allocate on
+};
+
+/**
+ * Nodes the calling thread may allocate memory on, as a bitmask.
+ * Returns 1 (node 0) if the kernel has no NUMA support.
+ */
+inline uint64_t numa_nodes_allowed() {
+  unsigned long mask = 0;
+  if(syscall(SYS_get_mempolicy, nullptr, &mask, sizeof(mask) * 8, nullptr, MPOL_F_MEMS_ALLOWED) != 0 || mask == 0)
+    return 1;
+  return mask;
+}
+
+/**
+ * Node holding the page at p, or -1 if it is unknown.
+ */
+inline int numa_node_of(const void* const p) {
+  int node = -1;
+  if(syscall(SYS_get_mempolicy, &node, nullptr, 0, p, MPOL_F_NODE | MPOL_F_ADDR) != 0)
+    return -1;
+  return node;
+}
+
+/**
+ * Allocator placing memory by numa_policy, for large, long lived arrays
+ * such as rings and bucket arrays. Every allocation is its own mapping,
+ * rounded up to whole (huge) pages.
+ *
+ * The policy is applied with mbind before the first touch. If pre-fault
+ * is set every page is then written once, so a thread on any node can
+ * construct the container and no page faults are taken on the hot path.
+ * Placement is best effort: should mbind fail, e.g. without NUMA support
+ * or in a restricted container, the memory is still usable.
+ */
+template<typename T>
+struct numa_allocator {
+  using value_type = T;
+
+  numa_policy _policy;
+  int         _node;
+  bool        _huge_pages;
+  bool        _prefault;
+
+  numa_allocator(const numa_policy policy = numa_policy::first_touch, const int node = 0,
+                 const bool huge_pages = true, const bool prefault = true) noexcept
+    : _policy(policy), _node(node), _huge_pages(huge_pages), _prefault(prefault) {}
+
+  template<typename U>
+  numa_allocator(const numa_allocator<U>& o) noexcept
+    : _policy(o._policy), _node(o._node), _huge_pages(o._huge_pages), _prefault(o._prefault) {}
+
+  static numa_allocator on_node(const int node) noexcept {
+    return numa_allocator(numa_policy::bind, node);
+  }
+
+  static numa_allocator interleaved() noexcept {
+    return numa_allocator(numa_policy::interleave);
+  }
+
+  size_t bytes(const size_t n) const noexcept {
+    const size_t page = _huge_pages && n * sizeof(T) >= HUGE_PAGE_SIZE ? HUGE_PAGE_SIZE : 4096;
+    return (n * sizeof(T) + page - 1) & ~(page - 1);
+  }
+
+  T* allocate(const size_t n) {
+    const size_t len = bytes(n);
+    char* const p = static_cast<char*>(map_pages(len, _huge_pages));
+    unsigned long mask = 0;
+    int mode = MPOL_DEFAULT;
+    if(_policy == numa_policy::bind) {
+      mode = MPOL_BIND;
+      mask = 1ul << _node;
+    }
+    else if(_policy == numa_policy::interleave) {
+      mode = MPOL_INTERLEAVE;
+      mask = numa_nodes_allowed();
+    }
+    if(mode != MPOL_DEFAULT)
+      syscall(SYS_mbind, p, len, mode, &mask, sizeof(mask) * 8, 0);
+    if(_prefault) {
+      for(size_t off = 0; off < len; off += 4096)
+        *reinterpret_cast<volatile char*>(p + off) = 0;
+    }
+    return reinterpret_cast<T*>(p);
+  }
+
+  void deallocate(T* const p, const size_t n) {
+    unmap_pages(p, bytes(n));
+  }
+
+  template<typename U>
+  bool operator==(const numa_allocator<U>& o) const noexcept {
+    return _policy == o._policy && _node == o._node && _huge_pages == o._huge_pages;
+  }
+
+  template<typename U>
+  bool operator!=(const numa_allocator<U>& o) const noexcept {
+    return !(*this == o);
+  }
+};
@@ -0,0 +1,395 @@
+#pragma once
+
+#include "pages.hpp"
+#include "treiber_stack.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/**
+ * Hands out the per-thread cache slots of every object_pool and gives
+ * them back when a thread exits. Each thread keeps the slots it holds in
+ * a thread_local list, whose destructor has the owning pools flush the
+ * magazines to their depots. Pools are identified by an id that is never
+ * reused, registered while the pool lives, so that an exiting thread
+ * skips pools destroyed in the meantime.
+ */
+class object_pool_base {
+
+  struct registry {
+    std::mutex                   _lock;
+    std::unordered_set<uint64_t> _live;
+    uint64_t                     _next = 0;
+  };
+
+  struct slot {
+    uint64_t          _id;
+    object_pool_base* _pool;
+    unsigned          _index;
+  };
+
+  struct thread_slots {
+    std::vector<slot> _slots;
+
+    ~thread_slots() {
+      registry& r = pools();
+      std::lock_guard<std::mutex> guard(r._lock);
+      for(const slot& s : _slots) {
+        if(r._live.count(s._id))
+          s._pool->release_slot(s._index);
+      }
+    }
+  };
+
+  static registry& pools() {
+    static registry instance;
+    return instance;
+  }
+
+  static thread_slots& mine() {
+    static thread_local thread_slots instance;
+    return instance;
+  }
+
+  static uint64_t register_pool() {
+    registry& r = pools();
+    std::lock_guard<std::mutex> guard(r._lock);
+    const uint64_t id = r._next++;
+    r._live.insert(id);
+    return id;
+  }
+
+protected:
+
+  const uint64_t _id;
+
+  object_pool_base() : _id(register_pool()) {}
+
+  // Must run first thing in the derived destructor.
+  void unregister() {
+    registry& r = pools();
+    std::lock_guard<std::mutex> guard(r._lock);
+    r._live.erase(_id);
+  }
+
+  virtual ~object_pool_base() {}
+
+  // Claims a free slot, or returns a value >= slots if all are taken.
+  virtual unsigned acquire_slot() = 0;
+
+  // Called on the exiting owner thread, under the registry lock.
+  virtual void release_slot(unsigned index) = 0;
+
+  /**
+   * The calling thread's slot in this pool, claimed on first use. A
+   * thread that found every slot taken stays uncached for this pool.
+   */
+  unsigned slot_index() {
+    thread_slots& t = mine();
+    for(const slot& s : t._slots) {
+      if(s._id == _id)
+        return s._index;
+    }
+    {
+      // Forget pools that were destroyed, ids are never reused.
+      registry& r = pools();
+      std::lock_guard<std::mutex> guard(r._lock);
+      for(size_t i = 0; i < t._slots.size(); ) {
+        if(r._live.count(t._slots[i]._id))
+          i++;
+        else {
+          t._slots[i] = t._slots.back();
+          t._slots.pop_back();
+        }
+      }
+    }
+    const unsigned index = acquire_slot();
+    t._slots.push_back(slot{_id, this, index});
+    return index;
+  }
+};
+
+/**
+ * Fixed size object pool with per-thread magazines (Bonwick & Adams).
+ *
+ * Each thread caches a loaded and a previous magazine of free objects
+ * and only goes to the shared depot, two treiber_stacks of full and
+ * empty magazines, once both are exhausted. The pool grows one slab at
+ * a time and only returns memory to the system on destruction.
+ *
+ * Each pool has MaxThreads cache slots. A thread claims one the first
+ * time it uses the pool and gives it back, magazines returned to the
+ * depot, when it exits. Threads finding all slots taken bypass the cache
+ * and work on the depot directly.
+ */
+template<typename T, size_t MagazineSize = 64, size_t MaxThreads = 64>
+class object_pool : private object_pool_base {
+
+  static constexpr size_t OBJECT_SIZE = (sizeof(T) + alignof(T) - 1) / alignof(T) * alignof(T);
+
+  struct magazine : public stack_node {
+    size_t _count = 0;
+    void*  _items[MagazineSize];
+
+    bool full() const noexcept { return _count == MagazineSize; }
+    bool empty() const noexcept { return _count == 0; }
+    void* pop() noexcept { return _items[--_count]; }
+    void push(void* p) noexcept { _items[_count++] = p; }
+  };
+
+  struct slab : public stack_node {
+    void*  _base;
+    size_t _bytes;
+
+    slab(void* base, size_t bytes) : stack_node(), _base(base), _bytes(bytes) {}
+  };
+
+  struct alignas(64) cache {
+    magazine*         _loaded = nullptr;
+    magazine*         _previous = nullptr;
+    std::atomic<bool> _owned{false};
+  };
+
+  treiber_stack<magazine> _full;
+  treiber_stack<magazine> _empty;
+  treiber_stack<slab>     _slabs;
+  const size_t _slab_objects;
+  const bool   _huge_pages;
+  cache        _caches[MaxThreads];
+
+  magazine* empty_magazine() {
+    magazine* m = _empty.pop();
+    return m ? m : new magazine;
+  }
+
+  /**
+   * Maps a new slab, keeps one full magazine of it and pushes the rest
+   * to the depot.
+   */
+  magazine* grow() {
+    size_t bytes = _slab_objects * OBJECT_SIZE;
+    if(_huge_pages)
+      bytes = (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    char* const base = static_cast<char*>(map_pages(bytes, _huge_pages));
+    _slabs.push(new slab(base, bytes));
+
+    const size_t n = bytes / OBJECT_SIZE;
+    magazine* result = nullptr;
+    for(size_t i = 0; i < n; i += MagazineSize) {
+      magazine* m = empty_magazine();
+      for(size_t j = i; j < n && j < i + MagazineSize; j++)
+        m->push(base + j * OBJECT_SIZE);
+      if(result)
+        _full.push(m);
+      else
+        result = m;
+    }
+    return result;
+  }
+
+  magazine* full_magazine() {
+    magazine* m = _full.pop();
+    return m ? m : grow();
+  }
+
+  void* allocate_uncached() {
+    magazine* m = full_magazine();
+    void* p = m->pop();
+    if(m->empty())
+      _empty.push(m);
+    else
+      _full.push(m);
+    return p;
+  }
+
+  void deallocate_uncached(void* p) {
+    magazine* m = _full.pop();
+    if(m && m->full()) {
+      _full.push(m);
+      m = nullptr;
+    }
+    if(!m)
+      m = empty_magazine();
+    m->push(p);
+    _full.push(m);
+  }
+
+  unsigned acquire_slot() override {
+    for(unsigned i = 0; i < MaxThreads; i++) {
+      bool owned = false;
+      if(!_caches[i]._owned.load(std::memory_order_relaxed) &&
+         _caches[i]._owned.compare_exchange_strong(owned, true, std::memory_order_acquire))
+        return i;
+    }
+    return MaxThreads;
+  }
+
+  void release_slot(const unsigned index) override {
+    if(index >= MaxThreads)
+      return;
+    cache& c = _caches[index];
+    for(magazine* m : {c._loaded, c._previous}) {
+      if(!m)
+        continue;
+      if(m->empty())
+        _empty.push(m);
+      else
+        _full.push(m);
+    }
+    c._loaded = c._previous = nullptr;
+    c._owned.store(false, std::memory_order_release);
+  }
+
+  static void delete_chain(magazine* m) {
+    while(m) {
+      magazine* next = static_cast<magazine*>(m->_next.load(std::memory_order_relaxed));
+      delete m;
+      m = next;
+    }
+  }
+
+public:
+
+  object_pool(const size_t slab_objects = 4096, const bool huge_pages = false)
+    : _slab_objects(slab_objects < MagazineSize ? MagazineSize : slab_objects),
+      _huge_pages(huge_pages) {}
+
+  object_pool(const object_pool&) = delete;
+  object_pool& operator=(const object_pool&) = delete;
+
+  // Objects still allocated are not destroyed, their memory is released.
+  ~object_pool() {
+    unregister();
+    for(cache& c : _caches) {
+      delete c._loaded;
+      delete c._previous;
+    }
+    delete_chain(_full.pop_all());
+    delete_chain(_empty.pop_all());
+    slab* s = _slabs.pop_all();
+    while(s) {
+      slab* next = static_cast<slab*>(s->_next.load(std::memory_order_relaxed));
+      unmap_pages(s->_base, s->_bytes);
+      delete s;
+      s = next;
+    }
+  }
+
+  /**
+   * Returns uninitialised storage for one T.
+   */
+  T* allocate() {
+    const unsigned index = slot_index();
+    if(index >= MaxThreads)
+      return static_cast<T*>(allocate_uncached());
+
+    cache& c = _caches[index];
+    if(c._loaded && !c._loaded->empty())
+      return static_cast<T*>(c._loaded->pop());
+    if(c._previous && c._previous->full()) {
+      std::swap(c._loaded, c._previous);
+      return static_cast<T*>(c._loaded->pop());
+    }
+    magazine* m = full_magazine();
+    if(c._previous)
+      _empty.push(c._previous);
+    c._previous = c._loaded;
+    c._loaded = m;
+    return static_cast<T*>(m->pop());
+  }
+
+  void deallocate(T* const p) {
+    const unsigned index = slot_index();
+    if(index >= MaxThreads)
+      return deallocate_uncached(p);
+
+    cache& c = _caches[index];
+    if(c._loaded && !c._loaded->full())
+      return c._loaded->push(p);
+    if(c._previous && c._previous->empty()) {
+      std::swap(c._loaded, c._previous);
+      return c._loaded->push(p);
+    }
+    if(c._previous)
+      _full.push(c._previous);
+    c._previous = c._loaded;
+    c._loaded = empty_magazine();
+    c._loaded->push(p);
+  }
+
+  // Threads holding a cache slot in this pool.
+  unsigned cached_threads() const noexcept {
+    unsigned n = 0;
+    for(const cache& c : _caches)
+      n += c._owned.load(std::memory_order_relaxed);
+    return n;
+  }
+
+  template<typename... Args>
+  T* create(Args&&... args) {
+    T* p = allocate();
+    try {
+      return new (p) T(std::forward<Args>(args)...);
+    }
+    catch(...) {
+      deallocate(p);
+      throw;
+    }
+  }
+
+  void destroy(T* const p) {
+    p->~T();
+    deallocate(p);
+  }
+};
+
+/**
+ * Standard allocator backed by a per-type object_pool.
+ *
+ * Single objects (e.g. list or queue nodes) come from the pool, arrays
+ * (e.g. the spsc_queue ring) are mapped directly, with a huge page hint.
+ */
+template<typename T>
+struct pool_allocator {
+  using value_type = T;
+
+  pool_allocator() noexcept = default;
+
+  template<typename U>
+  pool_allocator(const pool_allocator<U>&) noexcept {}
+
+  static object_pool<T>& pool() {
+    static object_pool<T> instance;
+    return instance;
+  }
+
+  static size_t array_bytes(const size_t n) noexcept {
+    const size_t bytes = n * sizeof(T);
+    return bytes < HUGE_PAGE_SIZE ? bytes : (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+  }
+
+  T* allocate(const size_t n) {
+    if(n == 1)
+      return pool().allocate();
+    return static_cast<T*>(map_pages(array_bytes(n), true));
+  }
+
+  void deallocate(T* const p, const size_t n) {
+    if(n == 1)
+      pool().deallocate(p);
+    else
+      unmap_pages(p, array_bytes(n));
+  }
+
+  template<typename U>
+  bool operator==(const pool_allocator<U>&) const noexcept { return true; }
+
+  template<typename U>
+  bool operator!=(const pool_allocator<U>&) const noexcept { return false; }
+};
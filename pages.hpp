@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+#include <sys/mman.h>
+
+static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+/**
+ * Anonymous mmap, optionally backed by huge pages. Falls back to normal
+ * pages with a transparent huge page hint if no huge pages are reserved
+ * or bytes is not a multiple of HUGE_PAGE_SIZE.
+ */
+inline void* map_pages(const size_t bytes, const bool huge_pages) {
+  if(huge_pages && bytes % HUGE_PAGE_SIZE == 0) {
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if(p != MAP_FAILED)
+      return p;
+  }
+  void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(p == MAP_FAILED)
+    throw std::bad_alloc();
+  if(huge_pages)
+    madvise(p, bytes, MADV_HUGEPAGE);
+  return p;
+}
+
+inline void unmap_pages(void* const p, const size_t bytes) {
+  munmap(p, bytes);
+}
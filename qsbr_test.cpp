@@ -1,4 +1,5 @@
 #include "qsbr.hpp"
+#include "counters.hpp"
 
 /**
  * Fixed size lock-free Hash Set that overwrites on insert.
@@ -69,7 +70,7 @@ simple_int_set<16> sss;
 #include <thread>
 
 std::atomic_int spin(0);
-std::atomic_int found(0);
+sharded_counter<> found;
 
 void foo(int seed) {
   spin--;
@@ -103,6 +104,6 @@ int main(int argc, char** argv) {
   }
   for(auto& t : threads)
     t.join();
-  std::cout << found << std::endl;
+  std::cout << found.read() << std::endl;
 }
 
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "gc.hpp"
+
+#include <atomic>
+#include <utility>
+
+/**
+ * Atomically replaceable pointer to a read-mostly object, reclaimed
+ * through qsbr.
+ *
+ * Readers load() the current version with a single acquire load and no
+ * reference count, the pointer stays valid until the reading thread's
+ * next quiescent state. Writers publish a new version with store(),
+ * exchange() or update(), the version it replaces is retired with
+ * deferred_delete and freed once every registered thread has passed
+ * through a quiescent state. Versions are immutable once published,
+ * update() copies the current one and changes the copy.
+ */
+template<typename T>
+class rcu_ptr {
+
+  struct version : public collectable {
+    T _value;
+
+    template<typename... Args>
+    explicit version(Args&&... args) : collectable(), _value(std::forward<Args>(args)...) {}
+  };
+
+  qsbr&                 _qs;
+  std::atomic<version*> _current;
+
+  static const T* value_of(const version* const v) noexcept {
+    return v ? &v->_value : nullptr;
+  }
+
+  version* swap(version* const next) {
+    version* const old = _current.exchange(next, std::memory_order_acq_rel);
+    if(old)
+      _qs.deferred_delete(old);
+    return old;
+  }
+
+public:
+
+  explicit rcu_ptr(qsbr& qs) : _qs(qs), _current(nullptr) {}
+
+  rcu_ptr(qsbr& qs, T value) : _qs(qs), _current(new version(std::move(value))) {}
+
+  rcu_ptr(const rcu_ptr&) = delete;
+  rcu_ptr& operator=(const rcu_ptr&) = delete;
+
+  ~rcu_ptr() {
+    delete _current.load();
+  }
+
+  /**
+   * The current version, or nullptr if there is none. Valid until the
+   * calling thread's next quiescent state.
+   */
+  const T* load() const noexcept {
+    return value_of(_current.load(std::memory_order_acquire));
+  }
+
+  const T& operator*() const noexcept {
+    return *load();
+  }
+
+  const T* operator->() const noexcept {
+    return load();
+  }
+
+  explicit operator bool() const noexcept {
+    return _current.load(std::memory_order_relaxed) != nullptr;
+  }
+
+  void store(T value) {
+    swap(new version(std::move(value)));
+  }
+
+  template<typename... Args>
+  void emplace(Args&&... args) {
+    swap(new version(std::forward<Args>(args)...));
+  }
+
+  /**
+   * Publishes value and returns the version it replaced, already
+   * retired and so only valid until the calling thread's next quiescent
+   * state.
+   */
+  const T* exchange(T value) {
+    return value_of(swap(new version(std::move(value))));
+  }
+
+  void reset() {
+    swap(nullptr);
+  }
+
+  /**
+   * Publishes a copy of the current version changed by fn(T&). Lock-free,
+   * fn is called again on a fresh copy if another writer got in first,
+   * so it should have no other side effects. Requires a current version.
+   */
+  template<typename Func>
+  void update(Func&& fn) {
+    version* old = _current.load(std::memory_order_acquire);
+    while(true) {
+      version* const next = new version(old->_value);
+      fn(next->_value);
+      if(_current.compare_exchange_strong(old, next, std::memory_order_acq_rel, std::memory_order_acquire)) {
+        _qs.deferred_delete(old);
+        return;
+      }
+      delete next;
+    }
+  }
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "thread_index.hpp"
+
+/**
+ * Reader-writer lock with distributed reader indicators.
+ *
+ * Readers only touch their own padded slot (a thread picks slot
+ * this_thread_index() % Slots), so read lock/unlock never write a
+ * shared cache line. Writers serialise on _writer, then wait for every
+ * slot to drain.
+ *
+ * With WriterPreference readers back off as soon as a writer is waiting,
+ * otherwise they only back off while a writer holds the lock.
+ */
+template<bool WriterPreference = true, size_t Slots = 64>
+class rw_lock {
+
+  static constexpr uint32_t FREE    = 0;
+  static constexpr uint32_t PENDING = 1; // a writer is waiting for readers
+  static constexpr uint32_t HELD    = 2; // a writer holds the lock
+
+  struct alignas(64) slot {
+    std::atomic<uint32_t> _readers{0};
+  };
+
+  std::atomic<uint32_t> _writer;
+  uint64_t _pad[7];
+  slot     _slots[Slots];
+
+  slot& my_slot() {
+    return _slots[this_thread_index() % Slots];
+  }
+
+  bool blocks_readers(const uint32_t w) const {
+    return WriterPreference ? w != FREE : w == HELD;
+  }
+
+  bool drained() const {
+    for(const slot& s : _slots)
+      if(s._readers.load(std::memory_order_seq_cst))
+        return false;
+    return true;
+  }
+
+public:
+
+  rw_lock() : _writer(FREE) {}
+
+  void lock_shared() {
+    slot& s = my_slot();
+    while(true) {
+      s._readers.fetch_add(1, std::memory_order_seq_cst);
+      if(!blocks_readers(_writer.load(std::memory_order_seq_cst)))
+        return;
+      s._readers.fetch_sub(1, std::memory_order_release);
+      while(blocks_readers(_writer.load(std::memory_order_relaxed)))
+        asm("pause");
+    }
+  }
+
+  bool try_lock_shared() {
+    slot& s = my_slot();
+    s._readers.fetch_add(1, std::memory_order_seq_cst);
+    if(!blocks_readers(_writer.load(std::memory_order_seq_cst)))
+      return true;
+    s._readers.fetch_sub(1, std::memory_order_release);
+    return false;
+  }
+
+  void unlock_shared() {
+    my_slot()._readers.fetch_sub(1, std::memory_order_release);
+  }
+
+  void lock() {
+    uint32_t w = FREE;
+    while(!_writer.compare_exchange_weak(w, PENDING, std::memory_order_seq_cst)) {
+      w = FREE;
+      asm("pause");
+    }
+    while(true) {
+      while(!drained())
+        asm("pause");
+      // Readers that arrived while we were PENDING may have entered
+      // (reader preference) so check again after publishing HELD.
+      _writer.store(HELD, std::memory_order_seq_cst);
+      if(WriterPreference || drained())
+        break;
+      _writer.store(PENDING, std::memory_order_relaxed);
+    }
+  }
+
+  bool try_lock() {
+    uint32_t w = FREE;
+    if(!_writer.compare_exchange_strong(w, HELD, std::memory_order_seq_cst))
+      return false;
+    if(drained())
+      return true;
+    _writer.store(FREE, std::memory_order_release);
+    return false;
+  }
+
+  void unlock() {
+    _writer.store(FREE, std::memory_order_release);
+  }
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "spin_lock.hpp"
+
+/**
+ * No-op lock for a seqlock with a single writer.
+ */
+struct null_lock {
+  void lock() {}
+  bool try_lock() { return true; }
+  void unlock() {}
+};
+
+/**
+ * Sequence lock for small trivially copyable snapshots.
+ *
+ * Readers never write shared memory: they copy the value out and retry
+ * if the sequence number was odd (write in progress) or changed. The
+ * value is stored as relaxed atomic words so a racing copy is torn but
+ * never undefined. Writers are serialised through WriteLock; use
+ * null_lock when there is only ever one writer.
+ */
+template<typename T, typename WriteLock = spin_lock>
+class seqlock : private WriteLock {
+
+  static_assert(std::is_trivially_copyable<T>::value, "T must be trivially_copyable!");
+
+  static constexpr size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+  std::atomic<uint64_t> _seq;
+  std::atomic<uint64_t> _data[WORDS];
+
+  void write_words(const T& value) {
+    uint64_t buf[WORDS] = {};
+    std::memcpy(buf, &value, sizeof(T));
+    for(size_t i = 0; i < WORDS; i++)
+      _data[i].store(buf[i], std::memory_order_relaxed);
+  }
+
+public:
+
+  seqlock(const T& value = T()) : _seq(0) {
+    write_words(value);
+  }
+
+  /**
+   * Returns false if a write was in progress or raced with the copy.
+   */
+  bool try_load(T& out) const {
+    const uint64_t before = _seq.load(std::memory_order_acquire);
+    if(before & 1)
+      return false;
+    uint64_t buf[WORDS];
+    for(size_t i = 0; i < WORDS; i++)
+      buf[i] = _data[i].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if(_seq.load(std::memory_order_relaxed) != before)
+      return false;
+    std::memcpy(&out, buf, sizeof(T));
+    return true;
+  }
+
+  T load() const {
+    T out;
+    while(!try_load(out))
+      asm("pause");
+    return out;
+  }
+
+  void store(const T& value) {
+    WriteLock::lock();
+    const uint64_t seq = _seq.load(std::memory_order_relaxed);
+    _seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    write_words(value);
+    _seq.store(seq + 2, std::memory_order_release);
+    WriteLock::unlock();
+  }
+
+  /**
+   * Read-modify-write under the write lock.
+   */
+  template<typename Func>
+  void update(Func&& fn) {
+    WriteLock::lock();
+    const uint64_t seq = _seq.load(std::memory_order_relaxed);
+    uint64_t buf[WORDS];
+    for(size_t i = 0; i < WORDS; i++)
+      buf[i] = _data[i].load(std::memory_order_relaxed);
+    T value;
+    std::memcpy(&value, buf, sizeof(T));
+    fn(value);
+    _seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    write_words(value);
+    _seq.store(seq + 2, std::memory_order_release);
+    WriteLock::unlock();
+  }
+
+  uint64_t version() const {
+    return _seq.load(std::memory_order_acquire) >> 1;
+  }
+};
+
+template<typename T>
+using single_writer_seqlock = seqlock<T, null_lock>;
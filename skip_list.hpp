@@ -0,0 +1,326 @@
+#pragma once
+
+#include "gc.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <new>
+
+struct no_value {};
+
+/**
+ * Lock-free skip list map (Herlihy & Shavit) with qsbr reclamation.
+ *
+ * Nodes are logically deleted by marking the low bit of their next
+ * pointers, top level first and level 0 last. Traversals that meet a
+ * marked node snip it out. A node is retired once both its inserter has
+ * finished linking it and its deleter has marked it, by whichever of
+ * the two comes second, so it can never be relinked after retirement.
+ *
+ * Like hash_set, every mutating operation ends with qs.quiescent(tid).
+ * Pointers and iterators obtained from find/lower_bound are valid until
+ * the calling thread next passes a quiescent state.
+ */
+template<typename Key,
+         typename Value = no_value,
+         typename Compare = std::less<Key>,
+         unsigned MaxLevel = 16>
+class skip_list : private Compare {
+
+  static constexpr uintptr_t MARK_BIT = 0x01;
+
+  struct node : public collectable {
+    const Key   _key;
+    const Value _value;
+    const unsigned _height;
+    std::atomic<unsigned>  _votes;
+    std::atomic<uintptr_t> _next[1]; // really _height long
+
+    node(const Key& k, const Value& v, const unsigned height)
+      : collectable(), _key(k), _value(v), _height(height), _votes(0) {
+      for(unsigned i = 0; i < height; i++)
+        new (_next + i) std::atomic<uintptr_t>(0);
+    }
+
+    virtual ~node() override {}
+
+    static void* operator new(size_t size, const unsigned height) {
+      return ::operator new(size + (height - 1) * sizeof(std::atomic<uintptr_t>));
+    }
+
+    static void operator delete(void* p) {
+      ::operator delete(p);
+    }
+
+    static void operator delete(void* p, unsigned) {
+      ::operator delete(p);
+    }
+  };
+
+  static node* strip_mark(const uintptr_t p) noexcept {
+    return reinterpret_cast<node*>(p & ~MARK_BIT);
+  }
+
+  static bool marked(const uintptr_t p) noexcept {
+    return p & MARK_BIT;
+  }
+
+  static uintptr_t as_word(const node* const n) noexcept {
+    return reinterpret_cast<uintptr_t>(n);
+  }
+
+  static unsigned random_height() {
+    static thread_local uint64_t state = reinterpret_cast<uintptr_t>(&state) | 1;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return 1 + __builtin_ctzl(state | (1ul << (MaxLevel - 1)));
+  }
+
+  bool less(const Key& a, const Key& b) const {
+    return Compare::operator()(a, b);
+  }
+
+  /**
+   * Fills preds/succs for key at every level, snipping marked nodes on
+   * the way. Returns true if an unmarked node with key is present.
+   */
+  bool find(const Key& key, node** preds, node** succs) {
+  retry:
+    node* pred = _head;
+    node* curr = nullptr;
+    for(int level = MaxLevel - 1; level >= 0; level--) {
+      curr = strip_mark(pred->_next[level].load(std::memory_order_acquire));
+      while(curr) {
+        uintptr_t succ = curr->_next[level].load(std::memory_order_acquire);
+        while(marked(succ)) {
+          uintptr_t expected = as_word(curr);
+          if(!pred->_next[level].compare_exchange_strong(expected, succ & ~MARK_BIT, std::memory_order_acq_rel))
+            goto retry;
+          curr = strip_mark(succ);
+          if(!curr)
+            break;
+          succ = curr->_next[level].load(std::memory_order_acquire);
+        }
+        if(curr && less(curr->_key, key)) {
+          pred = curr;
+          curr = strip_mark(succ);
+        }
+        else
+          break;
+      }
+      preds[level] = pred;
+      succs[level] = curr;
+    }
+    return curr && !less(key, curr->_key);
+  }
+
+  /**
+   * Read only search, never writes. Returns the first unmarked node with
+   * a key not less than key, or nullptr.
+   */
+  const node* search(const Key& key) const {
+    const node* pred = _head;
+    const node* curr = nullptr;
+    for(int level = MaxLevel - 1; level >= 0; level--) {
+      curr = strip_mark(pred->_next[level].load(std::memory_order_acquire));
+      while(curr) {
+        uintptr_t succ = curr->_next[level].load(std::memory_order_acquire);
+        while(marked(succ)) {
+          curr = strip_mark(succ);
+          if(!curr)
+            break;
+          succ = curr->_next[level].load(std::memory_order_acquire);
+        }
+        if(curr && less(curr->_key, key)) {
+          pred = curr;
+          curr = strip_mark(succ);
+        }
+        else
+          break;
+      }
+    }
+    return curr;
+  }
+
+  void release(node* const n) {
+    if(n->_votes.fetch_add(1, std::memory_order_acq_rel) == 1) {
+      node* preds[MaxLevel];
+      node* succs[MaxLevel];
+      find(n->_key, preds, succs); // make sure it is unlinked at every level
+      qs.deferred_delete(n);
+    }
+  }
+
+  node* const _head;
+
+public:
+
+  mutable qsbr qs;
+
+  class const_iterator {
+    const node* _node;
+
+    void skip_marked() {
+      while(_node && marked(_node->_next[0].load(std::memory_order_acquire)))
+        _node = strip_mark(_node->_next[0].load(std::memory_order_acquire));
+    }
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Key;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Key*;
+    using reference = const Key&;
+
+    explicit const_iterator(const node* n = nullptr) : _node(n) {
+      skip_marked();
+    }
+
+    const Key& operator*() const noexcept { return _node->_key; }
+    const Key* operator->() const noexcept { return &_node->_key; }
+    const Key& key() const noexcept { return _node->_key; }
+    const Value& value() const noexcept { return _node->_value; }
+
+    const_iterator& operator++() {
+      _node = strip_mark(_node->_next[0].load(std::memory_order_acquire));
+      skip_marked();
+      return *this;
+    }
+
+    bool operator==(const const_iterator& o) const noexcept { return _node == o._node; }
+    bool operator!=(const const_iterator& o) const noexcept { return _node != o._node; }
+  };
+
+  skip_list() : _head(new (MaxLevel) node(Key(), Value(), MaxLevel)) {}
+
+  ~skip_list() {
+    node* n = _head;
+    while(n) {
+      node* next = strip_mark(n->_next[0].load());
+      delete n;
+      n = next;
+    }
+  }
+
+  // If nonblocking is true this function is wait-free
+  bool find(const Key& key, const uint64_t tid, const bool nonblocking = true) const {
+    const node* n = search(key);
+    const bool result = n && !less(key, n->_key);
+    if(!nonblocking)
+      qs.quiescent(tid);
+    return result;
+  }
+
+  bool get(const Key& key, Value& out, const uint64_t tid, const bool nonblocking = true) const {
+    const node* n = search(key);
+    const bool result = n && !less(key, n->_key);
+    if(result)
+      out = n->_value;
+    if(!nonblocking)
+      qs.quiescent(tid);
+    return result;
+  }
+
+  bool insert(const Key& key, const uint64_t tid) {
+    return insert(key, Value(), tid);
+  }
+
+  bool insert(const Key& key, const Value& value, const uint64_t tid) {
+    node* preds[MaxLevel];
+    node* succs[MaxLevel];
+    const unsigned height = random_height();
+    node* n = nullptr;
+    while(true) {
+      if(find(key, preds, succs)) {
+        delete n;
+        qs.quiescent(tid);
+        return false;
+      }
+      if(!n)
+        n = new (height) node(key, value, height);
+      for(unsigned i = 0; i < height; i++)
+        n->_next[i].store(as_word(succs[i]), std::memory_order_relaxed);
+      uintptr_t expected = as_word(succs[0]);
+      if(preds[0]->_next[0].compare_exchange_strong(expected, as_word(n), std::memory_order_acq_rel))
+        break;
+    }
+
+    for(unsigned level = 1; level < height; level++) {
+      while(true) {
+        uintptr_t next = n->_next[level].load(std::memory_order_acquire);
+        if(marked(next))
+          goto done; // being erased, stop linking
+        if(next != as_word(succs[level]) &&
+           !n->_next[level].compare_exchange_strong(next, as_word(succs[level]), std::memory_order_acq_rel))
+          goto done;
+        uintptr_t expected = as_word(succs[level]);
+        if(preds[level]->_next[level].compare_exchange_strong(expected, as_word(n), std::memory_order_acq_rel))
+          break;
+        find(key, preds, succs);
+      }
+    }
+  done:
+    release(n);
+    qs.quiescent(tid);
+    return true;
+  }
+
+  bool erase(const Key& key, const uint64_t tid) {
+    node* preds[MaxLevel];
+    node* succs[MaxLevel];
+    if(!find(key, preds, succs)) {
+      qs.quiescent(tid);
+      return false;
+    }
+    node* const victim = succs[0];
+    for(int level = victim->_height - 1; level >= 1; level--) {
+      uintptr_t next = victim->_next[level].load(std::memory_order_acquire);
+      while(!marked(next))
+        victim->_next[level].compare_exchange_weak(next, next | MARK_BIT, std::memory_order_acq_rel);
+    }
+    uintptr_t next = victim->_next[0].load(std::memory_order_acquire);
+    while(true) {
+      if(marked(next)) {
+        // someone else erased it first
+        qs.quiescent(tid);
+        return false;
+      }
+      if(victim->_next[0].compare_exchange_weak(next, next | MARK_BIT, std::memory_order_acq_rel))
+        break;
+    }
+    release(victim);
+    qs.quiescent(tid);
+    return true;
+  }
+
+  const_iterator begin() const {
+    return const_iterator(strip_mark(_head->_next[0].load(std::memory_order_acquire)));
+  }
+
+  const_iterator end() const {
+    return const_iterator();
+  }
+
+  const_iterator lower_bound(const Key& key) const {
+    return const_iterator(search(key));
+  }
+
+  /**
+   * Calls fn(key, value) for every key in [lo, hi).
+   */
+  template<typename Func>
+  size_t scan(const Key& lo, const Key& hi, Func&& fn, const uint64_t tid, const bool nonblocking = true) const {
+    size_t count = 0;
+    for(const_iterator it = lower_bound(lo); it != end() && less(it.key(), hi); ++it, ++count)
+      fn(it.key(), it.value());
+    if(!nonblocking)
+      qs.quiescent(tid);
+    return count;
+  }
+};
+
+template<typename Key, typename Compare = std::less<Key>, unsigned MaxLevel = 16>
+using skip_set = skip_list<Key, no_value, Compare, MaxLevel>;
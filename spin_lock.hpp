@@ -1,14 +1,30 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <cstdint>
 #include <utility>
 
-class spin_lock {
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "contention_stats.hpp"
+
+/**
+ * Stats counts failed acquisition attempts as spins.
+ */
+template<typename Stats = no_stats>
+class basic_spin_lock : private Stats {
     std::atomic_flag _flag = ATOMIC_FLAG_INIT;
 public:
     void lock() {
-        while (_flag.test_and_set(std::memory_order_acq_rel))
+        uint64_t spins = 0;
+        while (_flag.test_and_set(std::memory_order_acq_rel)) {
             asm volatile("pause");
+            spins++;
+        }
+        Stats::spin(spins);
     }
 
     bool try_lock() {
@@ -18,19 +34,34 @@ public:
     void unlock() {
         _flag.clear(std::memory_order_release);
     }
+
+    const Stats& stats() const noexcept {
+        return *this;
+    }
 };
 
-class spin_lock_backoff {
+using spin_lock = basic_spin_lock<>;
+
+/**
+ * Stats counts pauses as spins.
+ */
+template<typename Stats = no_stats>
+class basic_spin_lock_backoff : private Stats {
+    static constexpr unsigned MAX_BACKOFF = 10; // at most 1024 pauses
     std::atomic_flag _flag = ATOMIC_FLAG_INIT;
 public:
     void lock() {
         unsigned backoff = 0;
+        uint64_t spins = 0;
         while (_flag.test_and_set(std::memory_order_acq_rel)) {
             for(unsigned i = 0; i < (1u << backoff); i++) {
                 asm volatile("pause");
             }
-            backoff++;
+            spins += 1u << backoff;
+            if(backoff < MAX_BACKOFF)
+                backoff++;
         }
+        Stats::spin(spins);
     }
 
     bool try_lock() {
@@ -40,5 +71,72 @@ public:
     void unlock() {
         _flag.clear(std::memory_order_release);
     }
+
+    const Stats& stats() const noexcept {
+        return *this;
+    }
 };
 
+using spin_lock_backoff = basic_spin_lock_backoff<>;
+
+/**
+ * Spin-then-park mutex.
+ *
+ * Spins for a bounded number of iterations which adapts to how long the
+ * lock was recently held, then sleeps on a futex. _state is 0 when
+ * unlocked, 1 when locked and 2 when locked with possible sleepers.
+ */
+class adaptive_lock {
+    static constexpr int32_t MAX_SPINS = 1 << 10;
+
+    std::atomic<uint32_t> _state;
+    std::atomic<int32_t>  _spins; // running average of successful spins
+
+    void futex_wait(const uint32_t expected) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&_state), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+    }
+
+    void futex_wake() {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&_state), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+    }
+
+public:
+    adaptive_lock() : _state(0), _spins(0) {}
+
+    void lock() {
+        uint32_t c = 0;
+        if(_state.compare_exchange_strong(c, 1, std::memory_order_acquire))
+            return;
+
+        const int32_t avg = _spins.load(std::memory_order_relaxed);
+        const int32_t limit = std::min(2 * avg + 16, MAX_SPINS);
+        for(int32_t i = 0; i < limit; i++) {
+            c = 0;
+            if(_state.load(std::memory_order_relaxed) == 0 &&
+               _state.compare_exchange_weak(c, 1, std::memory_order_acquire)) {
+                _spins.store(avg + (i - avg) / 8, std::memory_order_relaxed);
+                return;
+            }
+            asm volatile("pause");
+        }
+        _spins.store(avg + (limit - avg) / 8, std::memory_order_relaxed);
+
+        // Park. Once we have slept we must leave the lock in state 2 since
+        // there may be other sleepers.
+        c = _state.exchange(2, std::memory_order_acquire);
+        while(c != 0) {
+            futex_wait(2);
+            c = _state.exchange(2, std::memory_order_acquire);
+        }
+    }
+
+    bool try_lock() {
+        uint32_t c = 0;
+        return _state.compare_exchange_strong(c, 1, std::memory_order_acquire);
+    }
+
+    void unlock() {
+        if(_state.exchange(0, std::memory_order_release) == 2)
+            futex_wake();
+    }
+};
@@ -3,8 +3,13 @@
 #include <atomic>
 #include <memory>
 
-template<typename T, typename Allocator = std::allocator<T>>
-class spsc_queue : private Allocator {
+#include "contention_stats.hpp"
+
+/**
+ * Stats counts push() on a full and pop() on an empty queue.
+ */
+template<typename T, typename Allocator = std::allocator<T>, typename Stats = no_stats>
+class spsc_queue : private Allocator, Stats {
     std::atomic<uint64_t> _head;
     uint64_t _padding[7]; // for x86
     std::atomic<uint64_t> _tail;
@@ -16,6 +21,10 @@ public:
         : _head(0), _tail(0), _len(size), _mask(_len - 1),
             _data(Allocator::allocate(size)) {}
 
+    spsc_queue(const uint64_t size, const Allocator& alloc)
+        : Allocator(alloc), _head(0), _tail(0), _len(size), _mask(_len - 1),
+            _data(Allocator::allocate(size)) {}
+
     T& front() {
         return _data[_head & _mask];
     }
@@ -36,6 +45,7 @@ public:
         const uint64_t head_idx = _head.load(std::memory_order_relaxed);
         const uint64_t tail_idx = _tail.load(std::memory_order_acquire);
         if(head_idx == tail_idx) {
+            Stats::empty();
             return false;
         } 
         else {
@@ -50,7 +60,8 @@ public:
         const uint64_t tail_idx = _tail.load(std::memory_order_relaxed);
         const uint64_t head_idx = _head.load(std::memory_order_acquire);
         if((tail_idx - _len) == head_idx) {
-            return false; 
+            Stats::full();
+            return false;
         }
         else {
             new (&_data[tail_idx & _mask]) T(elem);
@@ -59,6 +70,10 @@ public:
         }
     }
 
+    const Stats& stats() const noexcept {
+        return *this;
+    }
+
     ~spsc_queue() {
         uint64_t tail_idx = _tail.load(std::memory_order_acquire);
         uint64_t head_idx = _head.load(std::memory_order_acquire);
@@ -0,0 +1,90 @@
+#include "../bloom_filter.hpp"
+#include "../hash_set.hpp"
+#include <gtest/gtest.h>
+
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#if defined(LOCKFREE_REQUIRE_AVX2) && !defined(__AVX2__)
+#error "bloom_filter_avx2 must be built with AVX2 enabled"
+#endif
+
+TEST(BloomFilter, NoFalseNegatives) {
+  bloom_filter f(100000);
+  for(uint64_t i = 0; i < 100000; i++)
+    f.insert(i);
+  for(uint64_t i = 0; i < 100000; i++)
+    ASSERT_TRUE(f.contains(i));
+
+  unsigned positives = 0;
+  for(uint64_t i = 100000; i < 200000; i++)
+    positives += f.contains(i);
+  ASSERT_LT(positives, 500u); // 0.5%
+
+  f.clear();
+  ASSERT_FALSE(f.contains(1));
+}
+
+TEST(BloomFilter, RandomHashes) {
+  // Full 64 bit hashes reach every block and bit position.
+  std::mt19937_64 gen(7);
+  std::vector<uint64_t> keys(50000);
+  for(auto& k : keys)
+    k = gen();
+  bloom_filter f(keys.size());
+  for(const uint64_t k : keys)
+    f.insert(k);
+  for(const uint64_t k : keys)
+    ASSERT_TRUE(f.contains(k));
+
+  unsigned positives = 0;
+  for(unsigned i = 0; i < 50000; i++)
+    positives += f.contains(gen());
+  ASSERT_LT(positives, 250u); // 0.5%
+}
+
+TEST(BloomFilter, ConcurrentInsert) {
+  bloom_filter f(1 << 16);
+  std::vector<std::thread> threads;
+  for(uint64_t t = 0; t < 4; t++) {
+    threads.emplace_back([&f, t] {
+      for(uint64_t i = t; i < (1 << 16); i += 4)
+        f.insert(i);
+    });
+  }
+  for(auto& t : threads)
+    t.join();
+  for(uint64_t i = 0; i < (1 << 16); i++)
+    ASSERT_TRUE(f.contains(i));
+}
+
+TEST(BloomFilter, HashSetFront) {
+  hash_set<int, 8, std::hash<int>, std::equal_to<int>, no_stats, std::allocator<int>, bloom_front> hs;
+  const uint64_t tid = hs.qs.register_thread();
+
+  for(int i = 0; i < 1000; i++)
+    hs.insert(i, tid); // rehashes several times
+  for(int i = 0; i < 1000; i++)
+    ASSERT_TRUE(hs.find(i, tid));
+  for(int i = 1000; i < 2000; i++)
+    ASSERT_FALSE(hs.find(i, tid));
+
+  for(int i = 0; i < 1000; i += 2)
+    ASSERT_TRUE(hs.erase(i, tid));
+  hs.rehash();
+  for(int i = 0; i < 1000; i++)
+    ASSERT_EQ(hs.find(i, tid), i % 2 == 1);
+}
+
+int main(int argc, char** argv) {
+#ifdef LOCKFREE_REQUIRE_AVX2
+  if(!__builtin_cpu_supports("avx2")) {
+    std::cout << "cpu lacks avx2, skipping" << std::endl;
+    return 77;
+  }
+#endif
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+};
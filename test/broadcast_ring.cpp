@@ -0,0 +1,94 @@
+#include "../broadcast_ring.hpp"
+
+#include <thread>
+#include <vector>
+#include <iostream>
+
+#include <csignal>
+#include <cstdio>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static broadcast_ring<long> ring(1024);
+
+void produce(long n) {
+    long i = 0;
+    while(i < n) {
+        // publish in batches of up to 16
+        const long batch = std::min(16l, n - i);
+        const uint64_t first = ring.claim(batch);
+        for(long j = 0; j < batch; j++)
+            ring[first + j] = i++;
+        ring.publish(first + batch);
+    }
+}
+
+void consume(const unsigned id, const int after, long n, long* sum, long* errors) {
+    while(n) {
+        n -= ring.poll(id, [&](const long v) {
+            *sum += v;
+            // a dependent stage never overtakes the stage it follows
+            if(after >= 0 && static_cast<long>(ring.position(after)) <= v)
+                (*errors)++;
+        }, 64);
+    }
+}
+
+// True if fn fails an assert, run in a child so the abort does not end the test.
+template<typename Func>
+bool aborts(Func fn) {
+    const pid_t pid = fork();
+    if(pid == 0) {
+        std::freopen("/dev/null", "w", stderr); // expected assert messages
+        fn();
+        _exit(0);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    return WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT;
+}
+
+// Misuse is caught instead of corrupting memory or spinning forever.
+long check_limits() {
+    long errors = 0;
+    broadcast_ring<long, 4> small(8);
+    for(unsigned i = 0; i < 4; i++)
+        errors += small.add_consumer() != i;
+    errors += !aborts([&] { small.add_consumer(); });
+
+    broadcast_ring<long, 4> deps(8);
+    deps.add_consumer();
+    errors += !aborts([&] { deps.add_consumer({1}); }); // itself
+    errors += !aborts([&] { deps.add_consumer({2}); }); // not added yet
+    errors += !aborts([&] { deps.claim(9); });
+    errors += !aborts([] { broadcast_ring<long> odd(1000); });
+    return errors;
+}
+
+int main() {
+    // Before any thread is started, fork() copies only this one.
+    const long limit_errors = check_limits();
+    std::cout << "limit errors " << limit_errors << std::endl;
+
+    const long n = 64 * 1024;
+    const unsigned a = ring.add_consumer();
+    const unsigned b = ring.add_consumer({a});
+    const unsigned c = ring.add_consumer();
+
+    long sums[3] = {0, 0, 0};
+    long errors = 0;
+    std::thread ta(consume, a, -1, n, &sums[0], &errors);
+    std::thread tb(consume, b, a, n, &sums[1], &errors);
+    std::thread tc(consume, c, -1, n, &sums[2], &errors);
+    std::thread producer(produce, n);
+
+    producer.join();
+    ta.join();
+    tb.join();
+    tc.join();
+
+    const long expected = n * (n - 1) / 2;
+    std::cout << expected << std::endl;
+    std::cout << sums[0] << ' ' << sums[1] << ' ' << sums[2] << ' ' << errors << std::endl;
+    return !(sums[0] == expected && sums[1] == expected && sums[2] == expected && errors == 0 && limit_errors == 0);
+}
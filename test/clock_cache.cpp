@@ -0,0 +1,93 @@
+#include "../clock_cache.hpp"
+#include <gtest/gtest.h>
+
+#include <random>
+#include <thread>
+#include <vector>
+
+TEST(ClockCache, Simple) {
+  clock_cache<int, long> cache(64);
+  const uint64_t tid = cache.register_thread();
+
+  long v;
+  ASSERT_FALSE(cache.get(1, v, tid));
+  ASSERT_TRUE(cache.insert(1, 10, tid));
+  ASSERT_FALSE(cache.insert(1, 20, tid)); // already cached
+  ASSERT_TRUE(cache.get(1, v, tid));
+  ASSERT_EQ(v, 10);
+  ASSERT_TRUE(cache.erase(1, tid));
+  ASSERT_FALSE(cache.erase(1, tid));
+  ASSERT_FALSE(cache.get(1, v, tid));
+  ASSERT_EQ(cache.hits(), 1);
+  ASSERT_EQ(cache.misses(), 2);
+}
+
+TEST(ClockCache, Bounded) {
+  clock_cache<int, long> cache(64);
+  const uint64_t tid = cache.register_thread();
+
+  for(int i = 0; i < 1000; i++)
+    ASSERT_TRUE(cache.insert(i, i, tid));
+
+  int cached = 0;
+  long v;
+  for(int i = 0; i < 1000; i++) {
+    if(cache.get(i, v, tid)) {
+      ASSERT_EQ(v, i);
+      cached++;
+    }
+  }
+  ASSERT_EQ(cached, 64);
+  ASSERT_EQ(cache.evictions(), 1000 - 64);
+}
+
+TEST(ClockCache, ReferencedSurvive) {
+  clock_cache<int, long> cache(64);
+  const uint64_t tid = cache.register_thread();
+
+  long v;
+  for(int i = 0; i < 64; i++)
+    cache.insert(i, i, tid);
+  for(int round = 0; round < 10; round++) {
+    ASSERT_TRUE(cache.get(0, v, tid));
+    for(int i = 0; i < 32; i++)
+      cache.insert(1000 + round * 32 + i, i, tid);
+  }
+  ASSERT_TRUE(cache.get(0, v, tid));
+}
+
+TEST(ClockCache, Concurrent) {
+  clock_cache<long, long> cache(1024);
+  std::vector<uint64_t> tids;
+  for(int t = 0; t < 4; t++)
+    tids.push_back(cache.register_thread());
+
+  std::atomic<long> errors(0);
+  std::vector<std::thread> threads;
+  for(int t = 0; t < 4; t++) {
+    threads.emplace_back([&, t] {
+      std::mt19937_64 gen(t);
+      long v;
+      for(int i = 0; i < 100000; i++) {
+        const long key = gen() % 4096;
+        if(cache.get(key, v, tids[t], false)) {
+          if(v != key * 3)
+            errors++;
+        }
+        else if(i % 64 == 0)
+          cache.erase(gen() % 4096, tids[t]);
+        else
+          cache.insert(key, key * 3, tids[t]);
+      }
+    });
+  }
+  for(auto& t : threads)
+    t.join();
+  ASSERT_EQ(errors.load(), 0);
+  ASSERT_EQ(cache.hits() + cache.misses(), 400000);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+};
@@ -0,0 +1,80 @@
+#include "../hash_set.hpp"
+#include "../mpsc_queue.hpp"
+#include "../spin_lock.hpp"
+#include "../spsc_queue.hpp"
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+using stats_set = hash_set<int, 8, std::hash<int>, std::equal_to<int>, contention_stats<>>;
+
+TEST(ContentionStats, ZeroCost) {
+  ASSERT_EQ(sizeof(spin_lock), sizeof(std::atomic_flag));
+  ASSERT_EQ(sizeof(spin_lock_backoff), sizeof(std::atomic_flag));
+}
+
+TEST(ContentionStats, HashSet) {
+  stats_set hs;
+  const uint64_t tid = hs.qs.register_thread();
+
+  for(int i = 0; i < 1000; i++)
+    hs.insert(i, tid);
+  for(int i = 0; i < 500; i++)
+    ASSERT_TRUE(hs.erase(i, tid));
+
+  const auto& stats = hs.stats();
+  ASSERT_EQ(stats.cas_failures.read(), 0);
+  ASSERT_EQ(stats.spins.read(), 0);
+  ASSERT_GT(stats.rehashes.read(), 0);
+  ASSERT_EQ(stats.rehash_ticks.count(), static_cast<uint64_t>(stats.rehashes.read()));
+  ASSERT_EQ(stats.retry_depth.count(), 1500u);
+  ASSERT_EQ(stats.retry_depth.percentile(100), 0u);
+
+  uint64_t counts[9];
+  hs.occupancy(counts, tid);
+  uint64_t items = 0;
+  for(unsigned i = 0; i <= 8; i++)
+    items += i * counts[i];
+  ASSERT_EQ(items, 500u);
+
+  hs.stats().reset();
+  ASSERT_EQ(hs.stats().rehashes.read(), 0);
+  ASSERT_EQ(hs.stats().retry_depth.count(), 0u);
+}
+
+TEST(ContentionStats, Queues) {
+  spsc_queue<int, std::allocator<int>, contention_stats<>> spsc(4);
+  int v;
+  ASSERT_FALSE(spsc.pop(v));
+  for(int i = 0; i < 4; i++)
+    ASSERT_TRUE(spsc.push(i));
+  ASSERT_FALSE(spsc.push(4));
+  ASSERT_FALSE(spsc.push(4));
+  ASSERT_EQ(spsc.stats().empties.read(), 1);
+  ASSERT_EQ(spsc.stats().fulls.read(), 2);
+
+  mpsc_queue<int, std::allocator<int>, contention_stats<>> mpsc;
+  ASSERT_FALSE(mpsc.pop(v));
+  mpsc.push(1);
+  ASSERT_TRUE(mpsc.pop(v));
+  ASSERT_EQ(mpsc.stats().empties.read(), 1);
+}
+
+TEST(ContentionStats, SpinLock) {
+  basic_spin_lock_backoff<contention_stats<>> lock;
+  lock.lock();
+  std::thread t([&lock] {
+    lock.lock();
+    lock.unlock();
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  lock.unlock();
+  t.join();
+  ASSERT_GT(lock.stats().spins.read(), 0);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+};
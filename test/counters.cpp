@@ -0,0 +1,59 @@
+#include "../counters.hpp"
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+TEST(Counters, ShardedCounter) {
+  sharded_counter<> c;
+  std::vector<std::thread> threads;
+  for(int t = 0; t < 8; t++)
+    threads.emplace_back([&c] {
+      for(int i = 0; i < 100000; i++)
+        ++c;
+      c += 5;
+    });
+  for(auto& t : threads)
+    t.join();
+  ASSERT_EQ(8 * 100005, c.read());
+  c.reset();
+  ASSERT_EQ(0, c.read());
+}
+
+TEST(Counters, Gauge) {
+  sharded_gauge<> g;
+  for(int i = -10; i <= 10; i++)
+    g.record(i * 3);
+  ASSERT_EQ(-30, g.min());
+  ASSERT_EQ(30, g.max());
+  ASSERT_EQ(0, g.sum());
+  ASSERT_EQ(21, g.count());
+}
+
+TEST(Counters, HistogramBuckets) {
+  using h = log_histogram<>;
+  for(uint64_t v = 0; v < 100000; v++) {
+    const unsigned b = h::bucket(v);
+    ASSERT_LE(h::lower_bound(b), v);
+    ASSERT_GE(h::upper_bound(b), v);
+  }
+  ASSERT_EQ(h::BUCKETS - 1, h::bucket(~0ul));
+}
+
+TEST(Counters, HistogramPercentiles) {
+  log_histogram<> hist;
+  for(uint64_t v = 1; v <= 1000; v++)
+    hist.record(v);
+  ASSERT_EQ(1000u, hist.count());
+  ASSERT_EQ(500500u, hist.sum());
+  // within one sub-bucket (12.5%) of the exact value
+  ASSERT_NEAR(500, hist.percentile(50), 500 / 8);
+  ASSERT_NEAR(990, hist.percentile(99), 990 / 8);
+  ASSERT_EQ(1u, hist.percentile(0));
+  ASSERT_GE(hist.percentile(100), 1000u);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
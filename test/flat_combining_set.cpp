@@ -0,0 +1,55 @@
+#include "../flat_combining.hpp"
+#include "../mcs_lock.hpp"
+
+#include <set>
+#include <thread>
+#include <vector>
+#include <iostream>
+
+struct set_op {
+    enum { INSERT, ERASE, FIND } kind;
+    int value;
+
+    bool operator()(std::set<int>& s) const {
+        switch(kind) {
+        case INSERT: return s.insert(value).second;
+        case ERASE:  return s.erase(value) > 0;
+        default:     return s.count(value) > 0;
+        }
+    }
+};
+
+static flat_combining<std::set<int>, set_op>                   spin_set;
+static flat_combining<std::set<int>, set_op, easy_mcs_lock<1>> mcs_set;
+static std::atomic<long> errors(0);
+
+template<typename Set>
+void work(Set* fc, const int id, const int n) {
+    const uint64_t tid = fc->register_thread();
+    for(int i = id * n; i < (id + 1) * n; i++) {
+        errors += !fc->apply(set_op{set_op::INSERT, i}, tid);
+        errors += !fc->apply(set_op{set_op::FIND, i}, tid);
+    }
+    for(int i = id * n; i < (id + 1) * n; i += 2)
+        errors += !fc->apply(set_op{set_op::ERASE, i}, tid);
+}
+
+template<typename Set>
+bool run(Set& fc, const int nthreads, const int n) {
+    std::vector<std::thread> threads;
+    for(int i = 0; i < nthreads; i++)
+      threads.emplace_back(work<Set>, &fc, i, n);
+    for(auto& t : threads)
+      t.join();
+
+    const size_t expected = nthreads * n / 2;
+    std::cout << expected << ' ' << fc.unsafe_container().size() << std::endl;
+    return fc.unsafe_container().size() == expected;
+}
+
+int main() {
+    bool ok = run(spin_set, 8, 10000);
+    ok &= run(mcs_set, 8, 10000);
+    std::cout << errors << std::endl;
+    return !(ok && errors == 0);
+}
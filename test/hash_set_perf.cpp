@@ -1,4 +1,6 @@
 #include "../hash_set.hpp"
+#include "../counters.hpp"
+#include "../bench/bench.hpp"
 
 #include <random>
 #include <vector>
@@ -11,7 +13,7 @@
 static hash_set<long> sss(1 << 16);
 
 static std::atomic_int spin(0);
-static volatile int found(0);
+static sharded_counter<> found;
 
 using namespace std::chrono;
 
@@ -52,7 +54,8 @@ void foo(const int seed) {
       counte += 1.0;
     }
   }
-  std::cout << std::setprecision(6) << std::right << sumf / countf / 3.5 << ' ' << sumi / counti / 3.5 << ' ' << sume / counte / 3.5 << std::endl;
+  const double ghz = tsc_clock::instance().ticks_per_ns();
+  std::cout << std::setprecision(6) << std::right << sumf / countf / ghz << ' ' << sumi / counti / ghz << ' ' << sume / counte / ghz << std::endl;
 }
 
 int main(int argc, char** argv) {
@@ -60,6 +63,7 @@ int main(int argc, char** argv) {
     return 2;
 
   const int n = atoi(argv[1]);
+  tsc_clock::instance(); // calibrate before the threads start
   spin.store(n);
   std::vector<std::thread> threads;
   for(int i = 1; i <= n; i++) {
@@ -67,5 +71,5 @@ int main(int argc, char** argv) {
   }
   for(auto& t : threads)
     t.join();
-  std::cout << found << std::endl;
+  std::cout << found.read() << std::endl;
 }
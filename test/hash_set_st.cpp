@@ -1,6 +1,10 @@
 #include "../hash_set.hpp"
 #include <gtest/gtest.h>
 
+#include <cstdio>
+#include <string>
+#include <vector>
+
 TEST(HashSet, Simple) {
   hash_set<int> hs;
 
@@ -14,7 +18,7 @@ TEST(HashSet, Simple) {
 
   for(int i = 0; i < 10; i++) {
     ASSERT_FALSE(hs.erase(i, tid)); // erase non-existing
-    hs.insert(i, tid);
+    ASSERT_TRUE(hs.insert(i, tid));
   }
 
   for(int i = 0; i < 10; i++) {
@@ -41,6 +45,87 @@ TEST(HashSet, ReHash) {
   ASSERT_TRUE(hs.find(5, tid));
 }
 
+struct kv {
+  int key;
+  int value;
+};
+
+struct kv_hash {
+  size_t operator()(const kv& x) const { return std::hash<int>()(x.key); }
+};
+
+struct kv_equal {
+  bool operator()(const kv& a, const kv& b) const { return a.key == b.key; }
+};
+
+TEST(HashSet, Get) {
+  hash_set<kv, 8, kv_hash, kv_equal> hs;
+
+  const uint64_t tid = hs.qs.register_thread();
+
+  for(int i = 0; i < 100; i++)
+    ASSERT_TRUE(hs.insert(kv{i, i * 10}, tid));
+  ASSERT_FALSE(hs.insert(kv{5, 0}, tid));
+
+  kv out{0, 0};
+  for(int i = 0; i < 100; i++) {
+    ASSERT_TRUE(hs.get(kv{i, 0}, out, tid));
+    ASSERT_EQ(out.value, i * 10);
+  }
+  ASSERT_FALSE(hs.get(kv{100, 0}, out, tid));
+}
+
+TEST(HashSet, BulkBuild) {
+  std::vector<int> keys;
+  for(int i = 0; i < 100000; i++)
+    keys.push_back(i % 50000); // every key twice
+
+  hash_set<int> hs;
+  const uint64_t tid = hs.qs.register_thread();
+  ASSERT_TRUE(hs.insert(-1, tid));
+  hs.bulk_build(keys.begin(), keys.end(), 4);
+
+  ASSERT_FALSE(hs.find(-1, tid)); // replaced
+  for(int i = 0; i < 50000; i++) {
+    ASSERT_TRUE(hs.find(i, tid));
+    ASSERT_FALSE(hs.insert(i, tid));
+  }
+  ASSERT_FALSE(hs.find(50000, tid));
+  ASSERT_TRUE(hs.insert(50000, tid));
+
+  hs.bulk_build(keys.begin(), keys.begin() + 1000, 3); // uneven bucket ranges
+  for(int i = 0; i < 1000; i++)
+    ASSERT_TRUE(hs.find(i, tid));
+  ASSERT_FALSE(hs.find(1000, tid));
+}
+
+TEST(HashSet, DumpLoad) {
+  const std::string path = testing::TempDir() + "hash_set_st.img";
+  hash_set<int> hs;
+  const uint64_t tid = hs.qs.register_thread();
+  for(int i = 0; i < 10000; i += 2)
+    ASSERT_TRUE(hs.insert(i, tid));
+  ASSERT_TRUE(hs.dump(path.c_str(), tid));
+
+  hash_set<int> loaded;
+  const uint64_t ltid = loaded.qs.register_thread();
+  ASSERT_TRUE(loaded.load(path.c_str(), 2));
+  for(int i = 0; i < 10000; i++)
+    ASSERT_EQ(loaded.find(i, ltid), i % 2 == 0);
+  ASSERT_TRUE(loaded.insert(1, ltid));
+
+  const hash_set<int>::image img(path.c_str());
+  ASSERT_TRUE(img.valid());
+  ASSERT_EQ(img.size(), 5000u);
+  for(int i = 0; i < 10000; i++)
+    ASSERT_EQ(img.find(i), i % 2 == 0);
+
+  hash_set<long> other;
+  ASSERT_FALSE(other.load(path.c_str())); // item size mismatch
+  ASSERT_FALSE(other.load("/nonexistent"));
+  std::remove(path.c_str());
+}
+
 int main(int argc, char** argv) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -0,0 +1,39 @@
+#include "../mcs_lock.hpp"
+
+#include <thread>
+#include <vector>
+#include <iostream>
+
+static easy_mcs_lock<>    mcs;
+static easy_cohort_lock<> cohort;
+
+static long mcs_count = 0;
+static long cohort_count = 0;
+
+void work(long n) {
+    while(n--) {
+        mcs.lock();
+        mcs_count++;
+        mcs.unlock();
+
+        cohort.lock();
+        cohort_count++;
+        cohort.unlock();
+    }
+}
+
+int main() {
+    const long n = 10000;
+    const int nthreads = 4;
+    std::vector<std::thread> threads;
+    for(int i = 0; i < nthreads; i++)
+      threads.emplace_back(work, n);
+
+    for(auto& t : threads)
+      t.join();
+
+    const long expected = nthreads * n;
+    std::cout << expected << std::endl;
+    std::cout << mcs_count << ' ' << cohort_count << std::endl;
+    return !(expected == mcs_count && expected == cohort_count);
+}
@@ -0,0 +1,74 @@
+#include "../mpsc_queue.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+
+static constexpr int TAG = 0x5eed;
+static std::atomic<long> errors(0);
+
+// Counts every use while not fully constructed.
+template<typename T>
+struct tagged_allocator {
+    using value_type = T;
+
+    int _tag;
+
+    explicit tagged_allocator(const int tag) noexcept : _tag(tag) {}
+
+    template<typename U>
+    tagged_allocator(const tagged_allocator<U>& o) noexcept : _tag(o._tag) {}
+
+    T* allocate(const size_t n) {
+        if(_tag != TAG)
+            errors++;
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* const p, const size_t n) {
+        if(_tag != TAG)
+            errors++;
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    template<typename U>
+    bool operator==(const tagged_allocator<U>& o) const noexcept { return _tag == o._tag; }
+
+    template<typename U>
+    bool operator!=(const tagged_allocator<U>& o) const noexcept { return _tag != o._tag; }
+};
+
+using queue = mpsc_queue<long, tagged_allocator<long>>;
+
+int main() {
+    // Construct over garbage so an allocator used before its constructor shows.
+    alignas(queue) unsigned char storage[sizeof(queue)];
+    std::memset(storage, 0xAB, sizeof(storage));
+    queue* const q = new (storage) queue(tagged_allocator<long>(TAG));
+
+    const long n = 100000;
+    std::vector<std::thread> threads;
+    for(int i = 0; i < 4; i++) {
+        threads.emplace_back([q, n] {
+            for(long j = 0; j < n; j++)
+                q->push(j);
+        });
+    }
+    long sum = 0;
+    for(long i = 0; i < 4 * n; i++) {
+        long l;
+        while(!q->pop(l));
+        sum += l;
+    }
+    for(auto& t : threads)
+        t.join();
+    q->~queue();
+
+    const long expected = 4 * n * (n - 1) / 2;
+    std::cout << sum << ' ' << errors << std::endl;
+    return !(expected == sum && errors == 0);
+}
@@ -0,0 +1,57 @@
+#include "../numa_allocator.hpp"
+#include "../hash_set.hpp"
+#include "../spsc_queue.hpp"
+
+#include <cassert>
+#include <iostream>
+#include <thread>
+
+#include <sched.h>
+
+static int current_node() {
+    unsigned cpu, node;
+    return getcpu(&cpu, &node) == 0 ? node : 0;
+}
+
+int main() {
+    const int node = current_node();
+    long errors = 0;
+
+    // Placement is best effort, only check it where the kernel reports it.
+    numa_allocator<long> bound = numa_allocator<long>::on_node(node);
+    long* p = bound.allocate(HUGE_PAGE_SIZE / sizeof(long) + 1);
+    const int actual = numa_node_of(p);
+    if(actual >= 0 && actual != node)
+        errors++;
+    bound.deallocate(p, HUGE_PAGE_SIZE / sizeof(long) + 1);
+
+    spsc_queue<long, numa_allocator<long>> queue(1 << 16, numa_allocator<long>::interleaved());
+    std::thread producer([&queue] {
+        for(long i = 0; i < 1000000; i++)
+            while(!queue.push(i));
+    });
+    long expected = 0;
+    while(expected < 1000000) {
+        long v;
+        if(queue.pop(v)) {
+            if(v != expected)
+                errors++;
+            expected++;
+        }
+    }
+    producer.join();
+
+    hash_set<long, 8, std::hash<long>, std::equal_to<long>, no_stats, numa_allocator<long>> set(16, bound);
+    const uint64_t tid = set.qs.register_thread();
+    for(long i = 0; i < 100000; i++)
+        set.insert(i, tid);
+    for(long i = 0; i < 100000; i++)
+        errors += !set.find(i, tid);
+    for(long i = 0; i < 100000; i += 2)
+        errors += !set.erase(i, tid);
+    for(long i = 0; i < 100000; i++)
+        errors += set.find(i, tid) == (i % 2 == 0);
+
+    std::cout << "node " << node << " errors " << errors << std::endl;
+    return !(errors == 0);
+}
@@ -0,0 +1,101 @@
+#include "../object_pool.hpp"
+#include "../mpsc_queue.hpp"
+#include "../spsc_queue.hpp"
+
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <iostream>
+
+struct order {
+    long id;
+    long price;
+
+    order(long i, long p) : id(i), price(p) {}
+};
+
+static object_pool<order, 16> pool(256);
+static std::atomic<long> errors(0);
+
+// Addresses handed out and not yet returned, kept outside the objects
+// so that create() cannot wipe the evidence of a double allocation.
+static std::mutex outstanding_lock;
+static std::unordered_set<order*> outstanding;
+
+void churn(long n) {
+    std::vector<order*> held;
+    while(n--) {
+        for(int i = 0; i < 50; i++) {
+            order* o = pool.create(n, i);
+            {
+                std::lock_guard<std::mutex> guard(outstanding_lock);
+                if(!outstanding.insert(o).second)
+                    errors++;
+            }
+            held.push_back(o);
+        }
+        for(order* o : held) {
+            if(o->price < 0 || o->price >= 50)
+                errors++;
+            {
+                std::lock_guard<std::mutex> guard(outstanding_lock);
+                outstanding.erase(o);
+            }
+            pool.destroy(o);
+        }
+        held.clear();
+    }
+}
+
+static mpsc_queue<long, pool_allocator<long>> mq;
+static spsc_queue<long, pool_allocator<long>> sq(1 << 20);
+
+void produce(long n) {
+    while(n--)
+        while(!mq.push(n));
+}
+
+int main() {
+    std::vector<std::thread> threads;
+    for(int i = 0; i < 8; i++)
+      threads.emplace_back(churn, 2000);
+    for(auto& t : threads)
+      t.join();
+    threads.clear();
+
+    // Exited threads give their cache slots back, so more threads than
+    // MaxThreads over the life of a pool all get cached.
+    static object_pool<order, 16, 4> small(256);
+    for(int i = 0; i < 16; i++) {
+        std::thread([] {
+            small.destroy(small.create(0, 0));
+        }).join();
+    }
+    std::thread([&] {
+        small.destroy(small.create(0, 0));
+        if(small.cached_threads() != 1)
+            errors++;
+    }).join();
+    if(small.cached_threads() != 0)
+        errors++;
+
+    const long n = 100000;
+    for(int i = 0; i < 4; i++)
+      threads.emplace_back(produce, n);
+    long sum = 0;
+    for(long i = 0; i < 4 * n; i++) {
+        long l;
+        while(!mq.pop(l));
+        sq.push(l);
+        sq.pop(l);
+        sum += l;
+    }
+    for(auto& t : threads)
+      t.join();
+
+    const long expected = 4 * n * (n - 1) / 2;
+    std::cout << expected << std::endl;
+    std::cout << sum << ' ' << errors << std::endl;
+    return !(expected == sum && errors == 0);
+}
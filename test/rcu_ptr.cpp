@@ -0,0 +1,82 @@
+#include "../rcu_ptr.hpp"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+struct limits {
+  long _lo;
+  long _hi; // always _lo * 2
+};
+
+TEST(RcuPtr, Simple) {
+  qsbr qs;
+  const uint64_t tid = qs.register_thread();
+
+  rcu_ptr<limits> ptr(qs);
+  ASSERT_FALSE(ptr);
+  ASSERT_EQ(ptr.load(), nullptr);
+
+  ptr.store(limits{1, 2});
+  ASSERT_TRUE(ptr);
+  ASSERT_EQ(ptr->_lo, 1);
+
+  const limits* const old = ptr.exchange(limits{3, 6});
+  ASSERT_EQ(old->_lo, 1); // retired but not freed before quiescent()
+  ASSERT_EQ((*ptr)._hi, 6);
+
+  ptr.update([](limits& l) { l._lo++; l._hi += 2; });
+  ASSERT_EQ(ptr->_lo, 4);
+  ASSERT_EQ(ptr->_hi, 8);
+  qs.quiescent(tid);
+
+  ptr.emplace(limits{5, 10});
+  ASSERT_EQ(ptr->_lo, 5);
+  ptr.reset();
+  ASSERT_FALSE(ptr);
+  qs.quiescent(tid);
+}
+
+TEST(RcuPtr, ConcurrentSwap) {
+  constexpr unsigned READERS = 3;
+  qsbr qs;
+  std::vector<uint64_t> tids;
+  for(unsigned i = 0; i <= READERS; i++)
+    tids.push_back(qs.register_thread());
+  rcu_ptr<limits> ptr(qs, limits{0, 0});
+
+  std::atomic<bool> stop(false);
+  std::atomic<long> torn(0);
+  std::vector<std::thread> readers;
+  for(unsigned r = 0; r < READERS; r++) {
+    readers.emplace_back([&, r] {
+      long last = 0;
+      while(!stop.load(std::memory_order_relaxed)) {
+        const limits* const l = ptr.load();
+        torn += l->_hi != l->_lo * 2 || l->_lo < last; // versions only move forward
+        last = l->_lo;
+        qs.quiescent(tids[r]);
+      }
+      qs.quiescent(tids[r]);
+    });
+  }
+
+  for(long i = 1; i <= 20000; i++) {
+    if(i % 2)
+      ptr.store(limits{i, i * 2});
+    else
+      ptr.update([](limits& l) { l._lo++; l._hi = l._lo * 2; });
+    qs.quiescent(tids[READERS]);
+  }
+  stop = true;
+  for(auto& t : readers)
+    t.join();
+  ASSERT_EQ(torn.load(), 0);
+  ASSERT_EQ(ptr->_lo, 20000);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+};
@@ -0,0 +1,60 @@
+#include "../rw_lock.hpp"
+
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+#include <iostream>
+
+struct pair_t {
+    long a = 0;
+    long b = 0;
+};
+
+template<typename Lock>
+struct shared_state {
+    Lock lock;
+    pair_t value;
+    std::atomic<long> torn{0};
+};
+
+template<typename Lock>
+void writer(shared_state<Lock>* s, long n) {
+    while(n--) {
+        std::lock_guard<Lock> guard(s->lock);
+        s->value.a++;
+        s->value.b++;
+    }
+}
+
+template<typename Lock>
+void reader(shared_state<Lock>* s, long n) {
+    while(n--) {
+        std::shared_lock<Lock> guard(s->lock);
+        if(s->value.a != s->value.b)
+            s->torn++;
+    }
+}
+
+template<typename Lock>
+bool run(const long n) {
+    shared_state<Lock> s;
+    std::vector<std::thread> threads;
+    for(int i = 0; i < 2; i++)
+      threads.emplace_back(writer<Lock>, &s, n);
+    for(int i = 0; i < 4; i++)
+      threads.emplace_back(reader<Lock>, &s, 4 * n);
+
+    for(auto& t : threads)
+      t.join();
+
+    std::cout << 2 * n << ' ' << s.value.a << ' ' << s.torn << std::endl;
+    return s.value.a == 2 * n && s.value.b == 2 * n && s.torn == 0;
+}
+
+int main() {
+    const long n = 10000;
+    bool ok = run<rw_lock<true>>(n);
+    ok &= run<rw_lock<false>>(n);
+    return !ok;
+}
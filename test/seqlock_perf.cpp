@@ -0,0 +1,76 @@
+#include "../seqlock.hpp"
+
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <chrono>
+
+struct snapshot {
+    long price;
+    long size;
+    long version;
+    long time;
+};
+
+static seqlock<snapshot> sl;
+static std::atomic_int spin(0);
+static std::atomic<bool> done(false);
+static volatile long sink(0);
+
+using namespace std::chrono;
+
+void reader(long* reads) {
+    spin--;
+    while(spin.load());
+    long n = 0;
+    long sum = 0;
+    while(!done.load(std::memory_order_relaxed)) {
+        sum += sl.load().price;
+        n++;
+    }
+    sink = sum;
+    *reads = n;
+}
+
+// Write rate of 0 means no writes, a negative rate means as fast as possible.
+void writer(const long rate) {
+    spin--;
+    while(spin.load());
+    long i = 0;
+    const auto start = steady_clock::now();
+    while(!done.load(std::memory_order_relaxed)) {
+        if(rate == 0)
+            break;
+        if(rate > 0 && i * 1000000000 / rate > duration_cast<nanoseconds>(steady_clock::now() - start).count())
+            continue;
+        sl.store(snapshot{i, i, i, i});
+        i++;
+    }
+}
+
+int main(int argc, char** argv) {
+    if(argc != 2)
+        return 2;
+
+    const int n = atoi(argv[1]);
+    const long rates[] = {0, 1000, 10000, 100000, 1000000, -1};
+    for(const long rate : rates) {
+        std::vector<long> reads(n);
+        std::vector<std::thread> threads;
+        spin.store(n + 1);
+        done.store(false);
+        for(int i = 0; i < n; i++)
+            threads.emplace_back(reader, &reads[i]);
+        threads.emplace_back(writer, rate);
+
+        std::this_thread::sleep_for(seconds(1));
+        done.store(true);
+        for(auto& t : threads)
+            t.join();
+
+        long total = 0;
+        for(const long r : reads)
+            total += r;
+        std::cout << rate << ' ' << total << std::endl;
+    }
+}
@@ -0,0 +1,56 @@
+#include "../seqlock.hpp"
+
+#include <thread>
+#include <vector>
+#include <iostream>
+
+struct quote {
+    long bid;
+    long ask;
+    long bid_size;
+    long ask_size;
+    long seq;
+};
+
+static seqlock<quote> sl(quote{0, 0, 0, 0, 0});
+static std::atomic<bool> done(false);
+static std::atomic<long> torn(0);
+
+void produce(long n, long id) {
+    while(n--) {
+        sl.store(quote{n, n, n, n, id});
+        sl.update([](quote& q) { q.seq++; });
+    }
+}
+
+void consume() {
+    long last = 0;
+    while(!done.load(std::memory_order_relaxed)) {
+        const quote q = sl.load();
+        if(q.bid != q.ask || q.bid != q.bid_size || q.bid != q.ask_size)
+            torn++;
+        if(static_cast<long>(sl.version()) < last)
+            torn++;
+        last = sl.version();
+    }
+}
+
+int main() {
+    const long n = 100000;
+    std::vector<std::thread> readers;
+    for(int i = 0; i < 4; i++)
+      readers.emplace_back(consume);
+
+    std::vector<std::thread> writers;
+    for(int i = 0; i < 2; i++)
+      writers.emplace_back(produce, n, i);
+    for(auto& t : writers)
+      t.join();
+
+    done = true;
+    for(auto& t : readers)
+      t.join();
+
+    std::cout << torn << ' ' << sl.version() << std::endl;
+    return !(torn == 0 && sl.version() == 2 * 2 * n);
+}
@@ -0,0 +1,96 @@
+#include "../skip_list.hpp"
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+TEST(SkipList, Simple) {
+  skip_set<int> sl;
+
+  const uint64_t tid = sl.qs.register_thread();
+
+  ASSERT_TRUE(sl.insert(5, tid));
+  ASSERT_TRUE(sl.find(5, tid));
+  ASSERT_TRUE(sl.erase(5, tid));
+  ASSERT_FALSE(sl.find(5, tid));
+  ASSERT_FALSE(sl.find(0, tid));
+
+  for(int i = 0; i < 100; i++) {
+    ASSERT_FALSE(sl.erase(i, tid)); // erase non-existing
+    ASSERT_TRUE(sl.insert(i, tid));
+  }
+
+  for(int i = 0; i < 100; i++) {
+    ASSERT_TRUE(sl.find(i, tid));
+    ASSERT_FALSE(sl.insert(i, tid)); // already exists
+  }
+
+  for(int i = 0; i < 100; i++) {
+    ASSERT_TRUE(sl.erase(i, tid));
+    ASSERT_FALSE(sl.find(i, tid)); // gone
+  }
+  ASSERT_TRUE(sl.begin() == sl.end());
+}
+
+TEST(SkipList, OrderedScan) {
+  skip_list<int, long> sl;
+
+  const uint64_t tid = sl.qs.register_thread();
+
+  for(int i = 99; i >= 0; i--)
+    sl.insert(i * 2, i * 10l, tid);
+
+  long value = 0;
+  ASSERT_TRUE(sl.get(42, value, tid));
+  ASSERT_EQ(210, value);
+  ASSERT_FALSE(sl.get(43, value, tid));
+
+  auto it = sl.lower_bound(43);
+  ASSERT_EQ(44, *it);
+  ASSERT_EQ(220, it.value());
+
+  int prev = -1;
+  for(const int k : sl) {
+    ASSERT_LT(prev, k);
+    prev = k;
+  }
+  ASSERT_EQ(198, prev);
+
+  std::vector<int> seen;
+  ASSERT_EQ(5u, sl.scan(10, 20, [&](const int k, long) { seen.push_back(k); }, tid));
+  ASSERT_EQ((std::vector<int>{10, 12, 14, 16, 18}), seen);
+
+  ASSERT_TRUE(sl.lower_bound(199) == sl.end());
+}
+
+TEST(SkipList, Concurrent) {
+  skip_set<long> sl;
+  const int nthreads = 4;
+  const long n = 20000;
+
+  std::vector<std::thread> threads;
+  for(int t = 0; t < nthreads; t++) {
+    const uint64_t tid = sl.qs.register_thread();
+    threads.emplace_back([&sl, tid, t, n] {
+      // every thread inserts all keys, and erases its own share
+      for(long i = 0; i < n; i++)
+        sl.insert(i, tid);
+      for(long i = t; i < n; i += nthreads)
+        sl.erase(i, tid);
+      for(long i = 0; i < n; i++)
+        sl.insert(i, tid);
+    });
+  }
+  for(auto& t : threads)
+    t.join();
+
+  long expected = 0;
+  for(const long k : sl)
+    ASSERT_EQ(expected++, k);
+  ASSERT_EQ(n, expected);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
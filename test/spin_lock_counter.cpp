@@ -0,0 +1,45 @@
+#include "../spin_lock.hpp"
+
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <iostream>
+
+static spin_lock         spin;
+static spin_lock_backoff backoff;
+static adaptive_lock     adaptive;
+
+static long spin_count = 0;
+static long backoff_count = 0;
+static long adaptive_count = 0;
+
+template<typename Lock>
+void work(Lock& lock, long* count, long n) {
+    while(n--) {
+        std::lock_guard<Lock> guard(lock);
+        (*count)++;
+    }
+}
+
+template<typename Lock>
+bool run(Lock& lock, long* count, const int nthreads, const long n) {
+    std::vector<std::thread> threads;
+    for(int i = 0; i < nthreads; i++)
+      threads.emplace_back(work<Lock>, std::ref(lock), count, n);
+
+    for(auto& t : threads)
+      t.join();
+
+    std::cout << nthreads * n << ' ' << *count << std::endl;
+    return *count == nthreads * n;
+}
+
+int main() {
+    const long n = 10000;
+    const int ncores = std::max(1u, std::thread::hardware_concurrency());
+    bool ok = run(spin, &spin_count, 4, n);
+    ok &= run(backoff, &backoff_count, 4, n);
+    // oversubscribed
+    ok &= run(adaptive, &adaptive_count, 4 * ncores, n);
+    return !ok;
+}
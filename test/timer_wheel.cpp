@@ -0,0 +1,87 @@
+#include "../timer_wheel.hpp"
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+TEST(TimerWheel, FiresOnDeadline) {
+  timer_wheel<uint64_t> wheel;
+  // One per level, either side of each level boundary, and overflow.
+  std::vector<uint64_t> deadlines = {0, 1, 5, 255, 256, 300, 65535, 65536, 70000,
+                                     (1ul << 24) + 3, (1ul << 32) - 1, (1ul << 32) + 7, (5ul << 32) + 1};
+  for(const uint64_t d : deadlines)
+    wheel.post(d, d);
+
+  std::vector<uint64_t> fired;
+  const auto collect = [&fired](const uint64_t v) { fired.push_back(v); };
+  for(const uint64_t d : deadlines) {
+    if(d > 0) {
+      ASSERT_EQ(wheel.tick(d - 1, collect), 0u) << d;
+    }
+    ASSERT_EQ(wheel.tick(d, collect), 1u) << d;
+    ASSERT_EQ(fired.back(), d);
+  }
+  ASSERT_EQ(wheel.now(), deadlines.back() + 1);
+}
+
+TEST(TimerWheel, Cancel) {
+  timer_wheel<int> wheel(1000);
+  std::vector<timer_wheel<int>::timer*> timers;
+  for(int i = 0; i < 1000; i++)
+    timers.push_back(wheel.schedule(1000 + i * 37, i));
+  wheel.post(999, -1); // already due
+
+  for(int i = 0; i < 1000; i += 2)
+    ASSERT_TRUE(wheel.cancel(timers[i]));
+
+  std::vector<int> fired;
+  ASSERT_EQ(wheel.tick(1000 + 500 * 37, [&fired](const int v) { fired.push_back(v); }), 251u);
+  ASSERT_EQ(fired.front(), -1);
+  for(size_t i = 1; i < fired.size(); i++)
+    ASSERT_EQ(fired[i] % 2, 1);
+
+  ASSERT_FALSE(wheel.cancel(timers[1])); // fired already
+  ASSERT_TRUE(wheel.cancel(timers[999]));
+  for(int i = 3; i < 999; i += 2)
+    wheel.release(timers[i]);
+  ASSERT_EQ(wheel.tick(1ul << 20, [&fired](const int v) { fired.push_back(v); }), 249u);
+}
+
+TEST(TimerWheel, ConcurrentInsert) {
+  constexpr unsigned THREADS = 4;
+  constexpr uint64_t PER_THREAD = 50000;
+  timer_wheel<uint64_t> wheel;
+  std::atomic<unsigned> done(0);
+  std::vector<std::thread> threads;
+  for(unsigned t = 0; t < THREADS; t++) {
+    threads.emplace_back([&wheel, &done, t] {
+      std::mt19937_64 rng(t);
+      for(uint64_t i = 0; i < PER_THREAD; i++) {
+        const uint64_t deadline = wheel.now() + rng() % 100000;
+        wheel.post(deadline, deadline);
+      }
+      done++;
+    });
+  }
+
+  uint64_t fired = 0, early = 0, now = 0;
+  const auto check = [&](const uint64_t deadline) {
+    fired++;
+    early += deadline > now;
+  };
+  while(done.load() < THREADS)
+    wheel.tick(now += 7, check);
+  for(auto& t : threads)
+    t.join();
+  wheel.tick(now += 1ul << 20, check);
+  ASSERT_EQ(fired, THREADS * PER_THREAD);
+  ASSERT_EQ(early, 0u);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+};
@@ -0,0 +1,68 @@
+#include "../treiber_stack.hpp"
+
+#include <thread>
+#include <vector>
+#include <iostream>
+
+struct item : public stack_node {
+    long value;
+    std::atomic<int> owners{0};
+};
+
+static treiber_stack<item> stack;
+static std::atomic<long> errors(0);
+
+void churn(long n) {
+    std::vector<item*> held;
+    while(n--) {
+        // pop a few, check nobody else holds them, push them back
+        for(int i = 0; i < 4; i++) {
+            item* it = stack.pop();
+            if(!it)
+                break;
+            if(it->owners.fetch_add(1) != 0)
+                errors++;
+            held.push_back(it);
+        }
+        for(item* it : held) {
+            it->owners.fetch_sub(1);
+            stack.push(it);
+        }
+        held.clear();
+    }
+}
+
+int main() {
+    const long nitems = 1024;
+    const long n = 100000;
+    std::vector<item> items(nitems);
+    for(long i = 0; i < nitems; i++) {
+        items[i].value = i;
+        stack.push(&items[i]);
+    }
+
+    std::vector<std::thread> threads;
+    for(int i = 0; i < 8; i++)
+      threads.emplace_back(churn, n);
+    for(auto& t : threads)
+      t.join();
+
+    // everything is still there exactly once
+    long sum = 0, count = 0;
+    item* chain = stack.pop_all();
+    item* last = chain;
+    for(item* it = chain; it; it = static_cast<item*>(it->_next.load())) {
+        sum += it->value;
+        count++;
+        last = it;
+    }
+    const long expected = nitems * (nitems - 1) / 2;
+    std::cout << expected << ' ' << sum << ' ' << count << ' ' << errors << std::endl;
+
+    stack.push_batch(chain, last);
+    long batch = 0;
+    while(stack.pop())
+        batch++;
+
+    return !(expected == sum && count == nitems && batch == nitems && errors == 0 && stack.empty());
+}
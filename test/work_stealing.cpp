@@ -0,0 +1,90 @@
+#include "../work_stealing_deque.hpp"
+#include "../executor.hpp"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <iostream>
+
+static qsbr qs;
+static work_stealing_deque<long> deque(qs, 16); // small so it has to grow
+static std::atomic<bool> done(false);
+static std::atomic<int> thieves(0);
+
+void owner(long n, long* sum, const uint64_t tid) {
+    for(long i = 1; i <= n; i++) {
+        deque.push(i);
+        if(i % 3 == 0) {
+            long v;
+            if(deque.pop(v))
+                *sum += v;
+        }
+        qs.quiescent(tid);
+    }
+    long v;
+    while(deque.pop(v))
+        *sum += v;
+    done = true;
+    while(thieves.load())
+        qs.quiescent(tid); // the thieves may still hold an old array
+}
+
+void thief(long* sum, const uint64_t tid) {
+    while(!done.load() || deque.size()) {
+        long v;
+        if(deque.steal(v))
+            *sum += v;
+        qs.quiescent(tid);
+    }
+    thieves--;
+}
+
+static std::atomic<long> leaves(0);
+
+void fork(executor& ex, const int depth) {
+    if(depth == 0) {
+        leaves++;
+        return;
+    }
+    ex.submit([&ex, depth] { fork(ex, depth - 1); });
+    ex.submit([&ex, depth] { fork(ex, depth - 1); });
+}
+
+int main() {
+    const long n = 1000000;
+    const int nthieves = 3;
+    std::vector<long> sums(nthieves + 1, 0);
+    // Every thread registers before any of them passes a quiescent state.
+    const uint64_t owner_tid = qs.register_thread();
+    std::vector<uint64_t> tids;
+    for(int i = 0; i < nthieves; i++)
+        tids.push_back(qs.register_thread());
+    thieves.store(nthieves);
+
+    std::vector<std::thread> threads;
+    threads.emplace_back(owner, n, &sums[0], owner_tid);
+    for(int i = 0; i < nthieves; i++)
+        threads.emplace_back(thief, &sums[i + 1], tids[i]);
+    for(auto& t : threads)
+        t.join();
+
+    long sum = 0;
+    for(long s : sums)
+        sum += s;
+    const long expected = n * (n + 1) / 2;
+    std::cout << expected << std::endl;
+    std::cout << sum << std::endl;
+
+    const int depth = 16;
+    {
+        executor ex(4);
+        ex.submit([&ex] { fork(ex, depth); });
+        ex.wait();
+        // Idle long enough for every worker to park, then wake them again.
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        ex.submit([&ex] { fork(ex, depth); });
+        ex.wait();
+    }
+    std::cout << (2 << depth) << ' ' << leaves << std::endl;
+    return !(expected == sum && leaves == (2 << depth));
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <atomic>
+
+/**
+ * Small dense per-thread index, assigned on first use and never reused.
+ * Used to pick a padded per-thread slot without registering threads.
+ */
+inline unsigned this_thread_index() {
+  static std::atomic<unsigned> next(0);
+  static thread_local const unsigned index = next.fetch_add(1, std::memory_order_relaxed);
+  return index;
+}
@@ -0,0 +1,358 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Lock-free hierarchical timing wheel.
+ *
+ * Four levels of 256 slots cover 2^32 ticks ahead of the wheel's time,
+ * deadlines further out wait in an overflow list. Every slot is a
+ * multi-producer list: any thread pushes a timer with a single CAS on
+ * the slot head, and the one ticking thread takes a whole slot at once
+ * with an exchange. Each tick drains one level 0 slot and expires the
+ * batch; a slot of level n is cascaded down every 256^n ticks. tick()
+ * jumps straight over empty stretches by way of per-level occupancy
+ * bitmaps, so an idle wheel costs nothing however long its ticks.
+ *
+ * Deadlines are absolute, in whatever unit the caller ticks in. A timer
+ * inserted before tick() is called fires on the first tick at or after
+ * its deadline. One inserted concurrently may fire on the next call.
+ *
+ * A timer is shared by its owner, holding the handle, and the wheel. A
+ * state word settles who frees it: cancel() and release() give up the
+ * handle, the wheel lets go of the timer once it has fired it or come
+ * across it cancelled, and whoever is last deletes it. Cancelled timers
+ * stay linked until the wheel reaches their slot.
+ */
+template<typename T>
+class timer_wheel {
+
+public:
+
+  class timer {
+    friend class timer_wheel;
+
+    const uint64_t        _deadline;
+    timer*                _next; // written before the timer is published
+    std::atomic<unsigned> _state;
+    T                     _value;
+
+    timer(const uint64_t deadline, const T& value, const unsigned state)
+      : _deadline(deadline), _next(nullptr), _state(state), _value(value) {}
+
+  public:
+
+    uint64_t deadline() const noexcept {
+      return _deadline;
+    }
+  };
+
+private:
+
+  static constexpr unsigned LEVELS = 4;
+  static constexpr unsigned SLOT_BITS = 8;
+  static constexpr unsigned SLOTS = 1 << SLOT_BITS;
+  static constexpr unsigned WORDS = SLOTS / 64;
+
+  enum : unsigned {
+    FIRED     = 1,
+    CANCELLED = 2,
+    RELEASED  = 4, // the owner dropped the handle
+    SWEPT     = 8  // the wheel is done with the timer
+  };
+
+  struct level {
+    std::atomic<timer*>   _slots[SLOTS];
+    std::atomic<uint64_t> _occupied[WORDS];
+    std::atomic<uint64_t> _recheck[WORDS]; // slots pushed to with a stale time
+  };
+
+  // Timers cascade() collects per slot, only touched by the ticking thread.
+  struct batch {
+    timer* _first;
+    timer* _last;
+  };
+
+  level _levels[LEVELS + 1]; // overflow in slot 0 of the last
+  alignas(64) std::atomic<uint64_t> _now; // next tick to process, or past it while ticking
+  std::atomic<bool>     _recheck;          // any level has recheck bits set
+  alignas(64) batch _batches[LEVELS + 1][SLOTS];
+  uint16_t _touched[(LEVELS + 1) * SLOTS];
+
+  static unsigned slot_of(const unsigned l, const uint64_t tick) noexcept {
+    return l < LEVELS ? (tick >> (l * SLOT_BITS)) & (SLOTS - 1) : 0;
+  }
+
+  /**
+   * Where a timer goes when every tick from ref on is yet to be
+   * processed: the lowest level whose slot for it comes round again
+   * within one revolution.
+   */
+  static void locate(const uint64_t deadline, const uint64_t ref, unsigned& l, unsigned& slot) noexcept {
+    const uint64_t d = deadline > ref ? deadline : ref;
+    for(l = 0; l < LEVELS; l++) {
+      const unsigned shift = l * SLOT_BITS;
+      if((d >> shift) - (ref >> shift) < SLOTS) {
+        slot = (d >> shift) & (SLOTS - 1);
+        return;
+      }
+    }
+    slot = 0;
+  }
+
+  // Pushes the chain first to last, already linked, onto a slot.
+  void push(timer* const first, timer* const last, const unsigned l, const unsigned slot) {
+    std::atomic<timer*>& head = _levels[l]._slots[slot];
+    timer* old = head.load(std::memory_order_relaxed);
+    do {
+      last->_next = old;
+    } while(!head.compare_exchange_weak(old, first, std::memory_order_seq_cst, std::memory_order_relaxed));
+    std::atomic<uint64_t>& word = _levels[l]._occupied[slot / 64];
+    const uint64_t mask = 1ul << (slot % 64);
+    if(!(word.load(std::memory_order_relaxed) & mask))
+      word.fetch_or(mask, std::memory_order_seq_cst);
+  }
+
+  timer* insert(timer* const t) {
+    const uint64_t now = _now.load(std::memory_order_seq_cst);
+    unsigned l, slot;
+    locate(t->_deadline, now, l, slot);
+    push(t, t, l, slot);
+    // The ticking thread may have drained the slot already, have it look again.
+    if(_now.load(std::memory_order_seq_cst) != now) {
+      _levels[l]._recheck[slot / 64].fetch_or(1ul << (slot % 64), std::memory_order_seq_cst);
+      _recheck.store(true, std::memory_order_seq_cst);
+    }
+    return t;
+  }
+
+  timer* drain(const unsigned l, const unsigned slot) {
+    std::atomic<uint64_t>& word = _levels[l]._occupied[slot / 64];
+    const uint64_t mask = 1ul << (slot % 64);
+    if(word.load(std::memory_order_relaxed) & mask)
+      word.fetch_and(~mask, std::memory_order_seq_cst);
+    std::atomic<timer*>& head = _levels[l]._slots[slot];
+    if(!head.load(std::memory_order_relaxed))
+      return nullptr;
+    return head.exchange(nullptr, std::memory_order_seq_cst);
+  }
+
+  /**
+   * Re-places every timer of the list relative to tick, dropping
+   * cancelled ones. Timers are chained up per slot first, so that each
+   * slot takes a single CAS however many timers move into it.
+   */
+  void cascade(timer* t, const uint64_t tick) {
+    unsigned touched = 0;
+    while(t) {
+      timer* const next = t->_next;
+      if(next)
+        __builtin_prefetch(next);
+      if(t->_state.load(std::memory_order_acquire) & CANCELLED)
+        delete t;
+      else {
+        unsigned l, slot;
+        locate(t->_deadline, tick, l, slot);
+        batch& b = _batches[l][slot];
+        if(b._first)
+          t->_next = b._first;
+        else {
+          b._last = t;
+          _touched[touched++] = l * SLOTS + slot;
+        }
+        b._first = t;
+      }
+      t = next;
+    }
+    for(unsigned i = 0; i < touched; i++) {
+      const unsigned l = _touched[i] / SLOTS, slot = _touched[i] % SLOTS;
+      batch& b = _batches[l][slot];
+      push(b._first, b._last, l, slot);
+      b._first = nullptr;
+    }
+  }
+
+  template<typename Func>
+  size_t expire(timer* t, const uint64_t tick, Func& fn) {
+    size_t fired = 0;
+    while(t) {
+      timer* const next = t->_next;
+      if(next)
+        __builtin_prefetch(next);
+      unsigned s = t->_state.load(std::memory_order_acquire);
+      if(s == RELEASED && t->_deadline <= tick) {
+        // Posted, nobody else can get at it.
+        fn(t->_value);
+        fired++;
+        delete t;
+        t = next;
+        continue;
+      }
+      if(!(s & CANCELLED) && t->_deadline > tick) {
+        unsigned l, slot;
+        locate(t->_deadline, tick + 1, l, slot);
+        push(t, t, l, slot);
+        t = next;
+        continue;
+      }
+      while(!(s & CANCELLED) &&
+            !t->_state.compare_exchange_weak(s, s | FIRED, std::memory_order_acq_rel, std::memory_order_acquire));
+      if(s & CANCELLED)
+        delete t;
+      else {
+        fn(t->_value);
+        fired++;
+        if(t->_state.fetch_or(SWEPT, std::memory_order_acq_rel) & RELEASED)
+          delete t;
+      }
+      t = next;
+    }
+    return fired;
+  }
+
+  template<typename Func>
+  size_t process(const uint64_t tick, Func& fn) {
+    if(_recheck.load(std::memory_order_relaxed) && _recheck.exchange(false, std::memory_order_seq_cst)) {
+      for(unsigned l = 0; l <= LEVELS; l++) {
+        for(unsigned w = 0; w < WORDS; w++) {
+          if(!_levels[l]._recheck[w].load(std::memory_order_relaxed))
+            continue;
+          for(uint64_t bits = _levels[l]._recheck[w].exchange(0, std::memory_order_seq_cst); bits; bits &= bits - 1)
+            cascade(drain(l, w * 64 + __builtin_ctzl(bits)), tick);
+        }
+      }
+    }
+    for(unsigned l = LEVELS; l > 0; l--) {
+      if((tick & ((1ul << (l * SLOT_BITS)) - 1)) == 0)
+        cascade(drain(l, slot_of(l, tick)), tick);
+    }
+    return expire(drain(0, tick & (SLOTS - 1)), tick, fn);
+  }
+
+  // Distance from start to the next occupied slot of a level, wrapping round, or SLOTS.
+  unsigned distance(const level& lv, const unsigned start) const noexcept {
+    for(unsigned i = 0; i <= WORDS; i++) {
+      const unsigned w = (start / 64 + i) % WORDS;
+      uint64_t bits = lv._occupied[w].load(std::memory_order_relaxed);
+      if(i == 0)
+        bits &= ~0ul << (start % 64);
+      else if(i == WORDS)
+        bits &= (1ul << (start % 64)) - 1;
+      if(bits)
+        return (w * 64 + __builtin_ctzl(bits) - start) & (SLOTS - 1);
+    }
+    return SLOTS;
+  }
+
+  // First tick from from on that may have work to do.
+  uint64_t next_event(const uint64_t from) const noexcept {
+    if(_recheck.load(std::memory_order_relaxed))
+      return from;
+    uint64_t next = UINT64_MAX;
+    for(unsigned l = 0; l <= LEVELS; l++) {
+      // Level l is drained at multiples of 2^shift only.
+      const unsigned shift = l * SLOT_BITS;
+      const uint64_t first = (from + (1ul << shift) - 1) >> shift;
+      const unsigned d = distance(_levels[l], l < LEVELS ? first & (SLOTS - 1) : 0);
+      if(d < SLOTS && (first + d) << shift < next)
+        next = (first + d) << shift;
+    }
+    return next;
+  }
+
+public:
+
+  explicit timer_wheel(const uint64_t now = 0) : _now(now), _recheck(false) {
+    for(auto& row : _batches)
+      for(auto& b : row)
+        b._first = b._last = nullptr;
+    for(auto& lv : _levels) {
+      for(auto& s : lv._slots)
+        s.store(nullptr, std::memory_order_relaxed);
+      for(unsigned w = 0; w < WORDS; w++) {
+        lv._occupied[w].store(0, std::memory_order_relaxed);
+        lv._recheck[w].store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  timer_wheel(const timer_wheel&) = delete;
+  timer_wheel& operator=(const timer_wheel&) = delete;
+
+  /**
+   * Deletes every timer still in the wheel, their handles included.
+   * Handles of timers that already fired must still be released.
+   */
+  ~timer_wheel() {
+    for(auto& lv : _levels) {
+      for(auto& s : lv._slots) {
+        for(timer* t = s.load(); t; ) {
+          timer* const next = t->_next;
+          delete t;
+          t = next;
+        }
+      }
+    }
+  }
+
+  /**
+   * Arms a timer firing value at deadline and returns its handle, to be
+   * given up with cancel() or release(). Lock-free, O(1).
+   */
+  timer* schedule(const uint64_t deadline, const T& value) {
+    return insert(new timer(deadline, value, 0));
+  }
+
+  // Same as schedule() without a handle, the timer cannot be cancelled.
+  void post(const uint64_t deadline, const T& value) {
+    insert(new timer(deadline, value, RELEASED));
+  }
+
+  /**
+   * Stops the timer unless it fired already, and gives up the handle
+   * either way. Returns true if the timer will not fire. Lock-free, O(1).
+   */
+  static bool cancel(timer* const t) {
+    unsigned s = t->_state.load(std::memory_order_relaxed);
+    while(!(s & FIRED)) {
+      if(t->_state.compare_exchange_weak(s, s | CANCELLED | RELEASED, std::memory_order_acq_rel, std::memory_order_relaxed))
+        return true;
+    }
+    release(t);
+    return false;
+  }
+
+  // Gives up the handle, leaving the timer to fire.
+  static void release(timer* const t) {
+    if(t->_state.fetch_or(RELEASED, std::memory_order_acq_rel) & SWEPT)
+      delete t;
+  }
+
+  // The next tick to process.
+  uint64_t now() const noexcept {
+    return _now.load(std::memory_order_acquire);
+  }
+
+  /**
+   * Processes every tick up to and including now, calling fn(T&) for
+   * each timer that comes due, and returns the number fired. Only one
+   * thread may tick.
+   */
+  template<typename Func>
+  size_t tick(const uint64_t now, Func&& fn) {
+    uint64_t t = _now.load(std::memory_order_relaxed);
+    if(now < t)
+      return 0;
+    // Inserts meanwhile place relative to the end of this call, which
+    // at worst finds their slots early and never late.
+    _now.store(now + 1, std::memory_order_seq_cst);
+    size_t fired = 0;
+    while(t <= now) {
+      fired += process(t, fn);
+      t = next_event(t + 1);
+    }
+    return fired;
+  }
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * Intrusive Hook Class
+ */
+struct stack_node {
+  std::atomic<stack_node*> _next;
+
+  stack_node() : _next(nullptr) {}
+};
+
+/**
+ * Intrusive lock-free Treiber stack with elimination backoff.
+ *
+ * The top pointer carries a 16 bit tag in its spare high bits (the same
+ * trick hash_set::zip plays) which is bumped on every update, so a pop
+ * cannot succeed against a top that was popped and pushed back in the
+ * meantime. Nodes are never freed by the stack and must stay readable
+ * while other threads may still pop them, e.g. by coming from a pool.
+ *
+ * When the top CAS fails, a push parks its node in a random slot of the
+ * elimination array for a short while and a pop tries to take a parked
+ * node, so that a push/pop pair cancels without touching the top.
+ */
+template<typename T = stack_node, unsigned EliminationSlots = 16>
+class treiber_stack {
+
+  static_assert(std::is_base_of<stack_node, T>::value, "T must derive from stack_node!");
+
+  static constexpr unsigned  TAG_SHIFT = 48;
+  static constexpr uintptr_t PTR_MASK  = (1ul << TAG_SHIFT) - 1;
+  static constexpr unsigned  ELIMINATION_SPINS = 128;
+
+  struct alignas(64) exchanger {
+    std::atomic<stack_node*> _node{nullptr};
+  };
+
+  std::atomic<uintptr_t> _top;
+  uint64_t  _pad[7];
+  exchanger _elimination[EliminationSlots];
+
+  static stack_node* ptr(const uintptr_t top) noexcept {
+    return reinterpret_cast<stack_node*>(top & PTR_MASK);
+  }
+
+  static uintptr_t next_tag(const uintptr_t top, const stack_node* const p) noexcept {
+    return ((top >> TAG_SHIFT) + 1) << TAG_SHIFT | reinterpret_cast<uintptr_t>(p);
+  }
+
+  static unsigned random_slot() {
+    static thread_local uint32_t state = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&state) >> 4) | 1;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state % EliminationSlots;
+  }
+
+  // Returns true if a concurrent pop took the node.
+  bool eliminate_push(stack_node* const n) {
+    exchanger& slot = _elimination[random_slot()];
+    stack_node* expected = nullptr;
+    if(!slot._node.compare_exchange_strong(expected, n, std::memory_order_release, std::memory_order_relaxed))
+      return false;
+    for(unsigned i = 0; i < ELIMINATION_SPINS; i++) {
+      if(slot._node.load(std::memory_order_relaxed) != n)
+        return true;
+      asm("pause");
+    }
+    expected = n;
+    return !slot._node.compare_exchange_strong(expected, nullptr, std::memory_order_relaxed);
+  }
+
+  stack_node* eliminate_pop() {
+    exchanger& slot = _elimination[random_slot()];
+    stack_node* n = slot._node.load(std::memory_order_acquire);
+    if(n && slot._node.compare_exchange_strong(n, nullptr, std::memory_order_acquire, std::memory_order_relaxed))
+      return n;
+    return nullptr;
+  }
+
+public:
+
+  treiber_stack() : _top(0) {}
+
+  bool empty() const noexcept {
+    return ptr(_top.load(std::memory_order_acquire)) == nullptr;
+  }
+
+  void push(T* const value) {
+    uintptr_t top = _top.load(std::memory_order_relaxed);
+    while(true) {
+      value->_next.store(ptr(top), std::memory_order_relaxed);
+      if(_top.compare_exchange_weak(top, next_tag(top, value), std::memory_order_release, std::memory_order_relaxed))
+        return;
+      if(eliminate_push(value))
+        return;
+      top = _top.load(std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * Pushes a chain first -> ... -> last already linked through _next.
+   */
+  void push_batch(T* const first, T* const last) {
+    uintptr_t top = _top.load(std::memory_order_relaxed);
+    do {
+      last->_next.store(ptr(top), std::memory_order_relaxed);
+    } while(!_top.compare_exchange_weak(top, next_tag(top, first), std::memory_order_release, std::memory_order_relaxed));
+  }
+
+  T* pop() {
+    uintptr_t top = _top.load(std::memory_order_acquire);
+    while(true) {
+      stack_node* const p = ptr(top);
+      if(!p)
+        return nullptr;
+      stack_node* const next = p->_next.load(std::memory_order_relaxed);
+      if(_top.compare_exchange_weak(top, next_tag(top, next), std::memory_order_acquire, std::memory_order_acquire))
+        return static_cast<T*>(p);
+      if(stack_node* const n = eliminate_pop())
+        return static_cast<T*>(n);
+      top = _top.load(std::memory_order_acquire);
+    }
+  }
+
+  /**
+   * Detaches the whole stack, returns the old top. The chain is linked
+   * through _next and ends in nullptr.
+   */
+  T* pop_all() {
+    uintptr_t top = _top.load(std::memory_order_acquire);
+    while(ptr(top) && !_top.compare_exchange_weak(top, next_tag(top, nullptr), std::memory_order_acquire, std::memory_order_acquire));
+    return static_cast<T*>(ptr(top));
+  }
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "gc.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * Chase-Lev work-stealing deque.
+ *
+ * The owner pushes and pops at the bottom, any thread may steal from
+ * the top. The circular array grows on demand and old arrays are
+ * retired through qsbr, so every thread touching the deque must be
+ * registered with it and call quiescent between operations.
+ */
+template<typename T>
+class work_stealing_deque {
+
+  static_assert(std::is_trivially_copyable<T>::value, "T must be trivially_copyable!");
+
+  struct array : public collectable {
+    const int64_t _size;
+    const int64_t _mask;
+    std::atomic<T>* const _data;
+
+    array(const int64_t size) : collectable(), _size(size), _mask(size - 1), _data(new std::atomic<T>[size]) {}
+
+    virtual ~array() override {
+      delete [] _data;
+    }
+
+    T get(const int64_t i) const noexcept {
+      return _data[i & _mask].load(std::memory_order_relaxed);
+    }
+
+    void put(const int64_t i, const T& value) noexcept {
+      _data[i & _mask].store(value, std::memory_order_relaxed);
+    }
+
+    array* grow(const int64_t bottom, const int64_t top) const {
+      array* a = new array(_size << 1);
+      for(int64_t i = top; i < bottom; i++)
+        a->put(i, get(i));
+      return a;
+    }
+  };
+
+  std::atomic<int64_t> _top;
+  uint64_t _pad1[7];
+  std::atomic<int64_t> _bottom;
+  std::atomic<array*>  _array;
+  uint64_t _pad2[6];
+  qsbr& _qs;
+
+public:
+
+  work_stealing_deque(qsbr& qs, const int64_t size = 256)
+    : _top(0), _bottom(0), _array(new array(size)), _qs(qs) {}
+
+  ~work_stealing_deque() {
+    delete _array.load();
+  }
+
+  size_t size() const {
+    const int64_t b = _bottom.load(std::memory_order_relaxed);
+    const int64_t t = _top.load(std::memory_order_relaxed);
+    return b > t ? b - t : 0;
+  }
+
+  // Owner only.
+  void push(const T& value) {
+    const int64_t b = _bottom.load(std::memory_order_relaxed);
+    const int64_t t = _top.load(std::memory_order_acquire);
+    array* a = _array.load(std::memory_order_relaxed);
+    if(b - t > a->_size - 1) {
+      array* old = a;
+      a = a->grow(b, t);
+      _array.store(a, std::memory_order_release);
+      _qs.deferred_delete(old);
+    }
+    a->put(b, value);
+    std::atomic_thread_fence(std::memory_order_release);
+    _bottom.store(b + 1, std::memory_order_relaxed);
+  }
+
+  // Owner only.
+  bool pop(T& value) {
+    const int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+    array* const a = _array.load(std::memory_order_relaxed);
+    _bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = _top.load(std::memory_order_relaxed);
+    if(t <= b) {
+      value = a->get(b);
+      if(t == b) {
+        // Last element, race against thieves.
+        const bool won = _top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        _bottom.store(b + 1, std::memory_order_relaxed);
+        return won;
+      }
+      return true;
+    }
+    _bottom.store(b + 1, std::memory_order_relaxed);
+    return false;
+  }
+
+  // Any thread. May fail spuriously when racing another thief.
+  bool steal(T& value) {
+    int64_t t = _top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t b = _bottom.load(std::memory_order_acquire);
+    if(t < b) {
+      array* const a = _array.load(std::memory_order_acquire);
+      value = a->get(t);
+      return _top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+    return false;
+  }
+};